@@ -71,6 +71,17 @@ bool init(AdcMask active_channels, float frequency_hz);
 
 std::optional<uint16_t> read(AdcInput channel);
 
+/**
+ * Copy the latest samples of count consecutive channels from first on,
+ * all from the same round-robin pass: a pass that completes during the
+ * copy makes it start again. The channels of a pass are converted one
+ * after the other, not at the same point in time. Inactive channels
+ * read as inactive_value.
+ * Returns false if the block goes past the last channel.
+ */
+bool read(AdcInput first, uint8_t count, uint16_t *values,
+          uint16_t inactive_value = uint16_t(-1));
+
 } // namespace adc
 } // namespace vla
 
@@ -0,0 +1,79 @@
+#ifndef VLA_ADC_CAPTURE_HPP
+#define VLA_ADC_CAPTURE_HPP
+
+#include <cstdint>
+#include <vla/adc.hpp>
+#include <vla/big_endian.hpp>
+
+// samples kept per channel, pre plus post trigger. The buffers take
+// CHANNEL_COUNT * 2 bytes per sample.
+#ifndef VLA_ADC_CAPTURE_DEPTH
+#define VLA_ADC_CAPTURE_DEPTH 512
+#endif
+
+namespace vla {
+namespace adc {
+
+/**
+ * Triggered capture at the full ADC rate. While armed the ADC
+ * interrupt records every active channel into its own ring buffer.
+ * Once the trigger fires the buffers keep pre_trigger samples from
+ * before it, record post_trigger samples starting with the triggering
+ * one and freeze until the capture is armed again. The channels are
+ * sampled round robin, so they line up to within one round.
+ *
+ * The trigger is only accepted once pre_trigger samples of the trigger
+ * channel have been recorded.
+ */
+constexpr uint16_t CAPTURE_DEPTH = VLA_ADC_CAPTURE_DEPTH;
+
+enum class TriggerMode : uint8_t {
+    LEVEL_ABOVE,  // a sample above threshold
+    LEVEL_BELOW,  // a sample below threshold
+    RISING_EDGE,  // from at most threshold to above it
+    FALLING_EDGE, // from at least threshold to below it
+    MANUAL        // only capture_trigger
+};
+
+enum class CaptureState : uint8_t { IDLE, ARMED, TRIGGERED, DONE };
+
+struct CaptureConfig {
+    AdcInput trigger_channel = AdcInput::ADC_0;
+    TriggerMode mode         = TriggerMode::RISING_EDGE;
+    uint16_t threshold       = 0x800;
+    uint16_t pre_trigger     = CAPTURE_DEPTH / 4;
+    uint16_t post_trigger    = CAPTURE_DEPTH - CAPTURE_DEPTH / 4;
+};
+
+// false if post_trigger is 0 or pre_trigger + post_trigger is over
+// CAPTURE_DEPTH. A capture in progress is dropped.
+bool capture_arm(const CaptureConfig &config);
+void capture_disarm();
+// fire the trigger now, if the capture is armed
+void capture_trigger();
+CaptureState capture_state();
+// samples per channel of a DONE capture
+uint16_t capture_length();
+
+/**
+ * Copy samples first to first + count of channel from a DONE capture,
+ * oldest first. Sample capture_pre_trigger() is the one that fired
+ * the trigger. Returns false if the capture is not DONE, the channel
+ * was inactive or the range goes past capture_length().
+ */
+bool capture_read(AdcInput channel, uint16_t first, uint16_t count,
+                  uint16_t *values);
+// the same, straight into a Modbus reply
+bool capture_read(AdcInput channel, uint16_t first, uint16_t count,
+                  RegisterWords words);
+uint16_t capture_pre_trigger();
+
+namespace detail {
+// called by the ADC interrupt for every good sample
+void capture_sample(uint8_t channel, uint16_t value);
+} // namespace detail
+
+} // namespace adc
+} // namespace vla
+
+#endif // VLA_ADC_CAPTURE_HPP
@@ -0,0 +1,57 @@
+#ifndef VLA_ADC_INPUT_REGISTERS_HPP
+#define VLA_ADC_INPUT_REGISTERS_HPP
+
+#include <cstdint>
+#include <vla/adc.hpp>
+#include <vla/big_endian.hpp>
+
+namespace vla {
+
+/**
+ * Maps the ADC channels to consecutive input registers from
+ * base_address on, so that a handler can serve them with:
+ *
+ *     bool is_read_input_registers_supported() {
+ *         return true;
+ *     }
+ *     bool is_read_input_registers_valid_data_address(uint16_t address,
+ *                                                     uint16_t count) {
+ *         return adc_registers.is_valid_data_address(address, count);
+ *     }
+ *     bool execute_read_input_registers(uint16_t address, uint16_t count,
+ *                                       vla::RegisterWords words) {
+ *         return adc_registers.read(address, count, words);
+ *     }
+ *
+ * The whole block is copied in one go, inactive channels read as
+ * 0xffff.
+ */
+class AdcInputRegisters {
+    uint16_t base_address;
+
+  public:
+    constexpr AdcInputRegisters(uint16_t base_address = 0)
+        : base_address(base_address) {
+    }
+    bool is_valid_data_address(uint16_t address,
+                               uint16_t register_count) const {
+        return address >= base_address &&
+               address + register_count <= base_address + adc::CHANNEL_COUNT;
+    }
+    bool read(uint16_t address, uint16_t register_count,
+              RegisterWords words) const {
+        uint16_t samples[adc::CHANNEL_COUNT];
+        if (!adc::read(adc::AdcInput(address - base_address), register_count,
+                       samples)) {
+            return false;
+        }
+        for (uint16_t i = 0; i < register_count; ++i) {
+            words[i] = samples[i];
+        }
+        return true;
+    }
+};
+
+} // namespace vla
+
+#endif // VLA_ADC_INPUT_REGISTERS_HPP
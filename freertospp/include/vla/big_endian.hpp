@@ -0,0 +1,89 @@
+#ifndef VLA_BIG_ENDIAN_HPP
+#define VLA_BIG_ENDIAN_HPP
+
+#include <cstdint>
+#include <type_traits>
+
+namespace vla {
+
+// Modbus sends 16 bit values most significant byte first. These work
+// a byte at a time, so the data needs no alignment: PDU fields are
+// often at odd offsets and the Cortex-M0+ faults on unaligned loads.
+
+inline uint16_t read_big_endian(const uint8_t *bytes) {
+    return uint16_t(bytes[0] << 8 | bytes[1]);
+}
+
+inline void write_big_endian(uint8_t *bytes, uint16_t v) {
+    bytes[0] = v >> 8;
+    bytes[1] = v;
+}
+
+// copy and byte swap in one pass
+inline void copy_to_big_endian(uint8_t *bytes, const uint16_t *words,
+                               uint16_t count) {
+    for (uint16_t i = 0; i < count; ++i) {
+        write_big_endian(&bytes[2 * i], words[i]);
+    }
+}
+
+inline void copy_from_big_endian(uint16_t *words, const uint8_t *bytes,
+                                 uint16_t count) {
+    for (uint16_t i = 0; i < count; ++i) {
+        words[i] = read_big_endian(&bytes[2 * i]);
+    }
+}
+
+/**
+ * A register in place in a PDU: converts to its value and assigning
+ * to it stores the new value big endian.
+ */
+class BigEndianRef {
+    uint8_t *bytes;
+
+  public:
+    explicit BigEndianRef(uint8_t *bytes) : bytes(bytes) {
+    }
+    operator uint16_t() const {
+        return read_big_endian(bytes);
+    }
+    BigEndianRef &operator=(uint16_t v) {
+        write_big_endian(bytes, v);
+        return *this;
+    }
+    BigEndianRef &operator=(const BigEndianRef &other) {
+        return *this = uint16_t(other);
+    }
+};
+
+/**
+ * The registers of a PDU, read and written in place through words[i]
+ * with no scratch copy. Byte is const uint8_t for read only views.
+ */
+template <typename Byte> class BigEndianWords {
+    Byte *bytes;
+
+  public:
+    explicit BigEndianWords(Byte *bytes) : bytes(bytes) {
+    }
+    auto operator[](uint16_t i) const {
+        if constexpr (std::is_const_v<Byte>) {
+            return read_big_endian(&bytes[2 * i]);
+        } else {
+            return BigEndianRef(&bytes[2 * i]);
+        }
+    }
+    BigEndianWords operator+(uint16_t i) const {
+        return BigEndianWords(bytes + 2 * i);
+    }
+    Byte *data() const {
+        return bytes;
+    }
+};
+
+using RegisterWords      = BigEndianWords<uint8_t>;
+using ConstRegisterWords = BigEndianWords<const uint8_t>;
+
+} // namespace vla
+
+#endif // VLA_BIG_ENDIAN_HPP
@@ -0,0 +1,91 @@
+#ifndef VLA_COIL_BANK_HPP
+#define VLA_COIL_BANK_HPP
+
+#include <cstdint>
+
+namespace vla {
+
+/**
+ * Coils, or discrete inputs, packed 32 to a word. Coil n is bit n % 32
+ * of word n / 32, the same order they have in the PDU, so read and
+ * write move them 32 at a time with a shift and a mask whatever the
+ * start address. A handler serves it with:
+ *
+ *     bool is_read_coils_valid_data_address(uint16_t address,
+ *                                           uint16_t bit_count) {
+ *         return coils.is_valid_data_address(address, bit_count);
+ *     }
+ *     bool execute_read_coils(uint16_t address, uint16_t bit_count,
+ *                             uint8_t *bytes) {
+ *         coils.read(address, bit_count, bytes);
+ *         return true;
+ *     }
+ *
+ * and likewise for execute_write_coils, execute_write_single_coil and
+ * execute_read_discrete_inputs. Updates are not atomic, banks shared
+ * with other tasks need a lock.
+ */
+template <uint16_t BitCount> class CoilBank {
+    static constexpr uint16_t WORD_COUNT = (BitCount + 31) / 32;
+    uint32_t words[WORD_COUNT] = {};
+
+    static uint32_t mask_of(uint16_t bit_count) {
+        return bit_count >= 32 ? ~uint32_t(0) : (uint32_t(1) << bit_count) - 1;
+    }
+
+  public:
+    static constexpr uint16_t SIZE = BitCount;
+
+    bool is_valid_data_address(uint16_t address, uint16_t bit_count) const {
+        return uint32_t(address) + bit_count <= BitCount;
+    }
+    bool get(uint16_t address) const {
+        return words[address / 32] >> (address % 32) & 1;
+    }
+    void set(uint16_t address, bool value) {
+        auto bit = uint32_t(1) << (address % 32);
+        words[address / 32] =
+            value ? words[address / 32] | bit : words[address / 32] & ~bit;
+    }
+    // bit i of the block goes to bit i % 8 of bytes[i / 8], the unused
+    // bits of the last byte are cleared.
+    void read(uint16_t address, uint16_t bit_count, uint8_t *bytes) const {
+        for (uint16_t done = 0; done < bit_count; done += 32) {
+            uint16_t bit   = address + done;
+            uint16_t word  = bit / 32;
+            uint16_t shift = bit % 32;
+            uint16_t count = bit_count - done < 32 ? bit_count - done : 32;
+            uint32_t v     = words[word] >> shift;
+            if (shift && shift + count > 32) {
+                v |= words[word + 1] << (32 - shift);
+            }
+            v &= mask_of(count);
+            for (uint16_t i = 0; i < (count + 7) / 8; ++i) {
+                *bytes++ = v >> (8 * i);
+            }
+        }
+    }
+    void write(uint16_t address, const uint8_t *bytes, uint16_t bit_count) {
+        for (uint16_t done = 0; done < bit_count; done += 32) {
+            uint16_t bit   = address + done;
+            uint16_t word  = bit / 32;
+            uint16_t shift = bit % 32;
+            uint16_t count = bit_count - done < 32 ? bit_count - done : 32;
+            uint32_t mask  = mask_of(count);
+            uint32_t v     = 0;
+            for (uint16_t i = 0; i < (count + 7) / 8; ++i) {
+                v |= uint32_t(*bytes++) << (8 * i);
+            }
+            v &= mask;
+            words[word] = (words[word] & ~(mask << shift)) | v << shift;
+            if (shift && shift + count > 32) {
+                words[word + 1] = (words[word + 1] & ~(mask >> (32 - shift))) |
+                                  v >> (32 - shift);
+            }
+        }
+    }
+};
+
+} // namespace vla
+
+#endif // VLA_COIL_BANK_HPP
@@ -7,8 +7,15 @@
 extern "C" {
 #endif
 
+#define VLA_MODBUS_CRC16_INIT 0xFFFF
+
 uint16_t vla_modbus_crc16(const uint8_t *data, uint16_t data_lengh);
 
+// feed one more byte to a running CRC started at VLA_MODBUS_CRC16_INIT.
+// Running it over a whole frame, CRC included, leaves 0 if the frame is
+// intact. C++ code should prefer the inline vla::crc16::update.
+uint16_t vla_modbus_crc16_update(uint16_t crc, uint8_t byte);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,127 @@
+#ifndef VLA_CRC16_HPP
+#define VLA_CRC16_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// number of bytes consumed per step by the default engine: 1, 4 or 8.
+// Each step needs one more 512 bytes table.
+#ifndef VLA_CRC16_SLICES
+#define VLA_CRC16_SLICES 1
+#endif
+
+namespace vla {
+namespace crc16 {
+
+// CRC-16/MODBUS: reflected 0x8005 polynomial, 0xffff initial value.
+constexpr uint16_t POLYNOMIAL = 0xa001;
+constexpr uint16_t INIT       = 0xffff;
+
+/**
+ * Lookup tables for slicing-by-N. tables[0] is the classic byte wise
+ * table, tables[k][i] is the CRC of byte i followed by k zero bytes.
+ */
+template <size_t N> struct Tables {
+    uint16_t t[N][256];
+};
+
+template <size_t N> constexpr Tables<N> make_tables() {
+    Tables<N> tables = {};
+    for (uint16_t i = 0; i < 256; ++i) {
+        uint16_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = crc & 1 ? (crc >> 1) ^ POLYNOMIAL : crc >> 1;
+        }
+        tables.t[0][i] = crc;
+    }
+    for (size_t k = 1; k < N; ++k) {
+        for (uint16_t i = 0; i < 256; ++i) {
+            auto prev      = tables.t[k - 1][i];
+            tables.t[k][i] = (prev >> 8) ^ tables.t[0][prev & 0xff];
+        }
+    }
+    return tables;
+}
+
+template <size_t N> inline constexpr Tables<N> tables = make_tables<N>();
+
+static_assert(tables<1>.t[0][1] == 0xc0c1 && tables<1>.t[0][255] == 0x4040,
+              "CRC-16/MODBUS table");
+
+constexpr uint16_t update(uint16_t crc, uint8_t byte) {
+    return (crc >> 8) ^ tables<1>.t[0][uint8_t(crc ^ byte)];
+}
+
+/**
+ * Feed length bytes to a running CRC, Slices bytes at a time. The
+ * bytes are loaded one by one, so data needs no particular alignment.
+ */
+template <size_t Slices>
+uint16_t update(uint16_t crc, const uint8_t *data, size_t length) {
+    static_assert(Slices == 1 || Slices == 4 || Slices == 8,
+                  "1, 4 or 8 slices");
+    if constexpr (Slices > 1) {
+        constexpr auto &t = tables<Slices>.t;
+        for (; length >= Slices; length -= Slices, data += Slices) {
+            uint16_t x = crc ^ (data[0] | data[1] << 8);
+            if constexpr (Slices == 4) {
+                crc = t[3][x & 0xff] ^ t[2][x >> 8] ^ t[1][data[2]] ^
+                      t[0][data[3]];
+            } else {
+                crc = t[7][x & 0xff] ^ t[6][x >> 8] ^ t[5][data[2]] ^
+                      t[4][data[3]] ^ t[3][data[4]] ^ t[2][data[5]] ^
+                      t[1][data[6]] ^ t[0][data[7]];
+            }
+        }
+    }
+    while (length--) {
+        crc = update(crc, *data++);
+    }
+    return crc;
+}
+
+constexpr uint16_t compute(const uint8_t *data, size_t length) {
+    uint16_t crc = INIT;
+    while (length--) {
+        crc = update(crc, *data++);
+    }
+    return crc;
+}
+
+/**
+ * Resumable CRC state, for data that arrives in pieces. Once the
+ * whole frame, CRC included, has been fed the residue is 0 if the
+ * frame is intact.
+ */
+template <size_t Slices = VLA_CRC16_SLICES> class Stream {
+    uint16_t crc = INIT;
+
+  public:
+    void reset() {
+        crc = INIT;
+    }
+    void update(uint8_t byte) {
+        crc = crc16::update(crc, byte);
+    }
+    void update(const uint8_t *data, size_t length) {
+        crc = crc16::update<Slices>(crc, data, length);
+    }
+    uint16_t value() const {
+        return crc;
+    }
+    bool is_residue_ok() const {
+        return crc == 0;
+    }
+};
+
+namespace detail {
+constexpr uint8_t check_string[] = {'1', '2', '3', '4', '5',
+                                    '6', '7', '8', '9'};
+}
+static_assert(compute(detail::check_string, 9) == 0x4b37,
+              "CRC-16/MODBUS check value");
+
+} // namespace crc16
+} // namespace vla
+
+#endif // VLA_CRC16_HPP
@@ -0,0 +1,168 @@
+#ifndef VLA_DEFERRED_HANDLER_HPP
+#define VLA_DEFERRED_HANDLER_HPP
+
+#include <FreeRTOS.h>
+#include <cstdint>
+#include <cstring>
+#include <vla/crc16.h>
+#include <vla/hw_timer.hpp>
+#include <vla/modbus_daemon_fsm.hpp>
+#include <vla/modbus_stats.hpp>
+#include <vla/queue.hpp>
+#include <vla/rtu_message.hpp>
+
+namespace vla {
+
+/**
+ * Handler wrapper that runs slow requests, such as flash writes, in a
+ * worker task so that they do not hold the daemon:
+ *
+ * static auto deferred_handler = vla::DeferredHandler(
+ *     rtu_handler, vla::RtuAddress(0x01), PeriodUs(5000),
+ *     vla::RtuFunctionCode::WRITE_FILE_RECORD);
+ * auto worker = vla::Task(
+ *     [] { deferred_handler.work(); }, "Modbus Worker", 512);
+ * vla::modbus_daemon(context, transport, deferred_handler);
+ *
+ * The functions in deferred are handed to the worker and the daemon
+ * goes on tracking the bus. It sends the reply if the worker is done
+ * within budget, otherwise the master gets ACKNOLEDGE and polls by
+ * sending the same request again: it gets SERVER_DEVICE_BUSY while the
+ * worker is still on it and the reply once it is done. Any other
+ * request is answered with SERVER_DEVICE_BUSY while the worker runs,
+ * so the handler is never called from both tasks at once. A new
+ * request drops a result that was never collected.
+ *
+ * It must be given to the daemon as it is: wrapped in another handler
+ * the daemon cannot see the defer member and the deferred functions
+ * run in the daemon task.
+ */
+template <typename Handler> class DeferredHandler {
+    struct Job {};
+    enum class State : uint8_t { IDLE, RUNNING, DONE };
+
+    Handler &handler;
+    const RtuAddress address;
+    const PeriodUs budget;
+    const FunctionSet deferred;
+    Queue<Job> jobs{1};
+    // the daemon queue, told when the job is done
+    ModbusDaemonQueue *done = nullptr;
+    // only the daemon task touches state, the worker only the job
+    // buffers and only between a jobs message and its IndicationDone.
+    State state = State::IDLE;
+    uint16_t indication_length;
+    uint16_t frame_length;
+    // the request being served, to tell its polls apart
+    uint8_t indication[PDU_MAX];
+    // handled in place, it ends up holding the reply
+    uint8_t frame[PDU_MAX];
+
+    static void make_exception_reply(RtuExceptionCode ex,
+                                     const RtuMessage &msg,
+                                     RtuMessage &reply) {
+        reply.buffer[0] = msg.buffer[0];
+        reply.buffer[1] = msg.buffer[1] | 0x80;
+        reply.buffer[2] = uint8_t(ex);
+        auto crc        = vla_modbus_crc16(reply.buffer, 3);
+        reply.buffer[3] = crc;
+        reply.buffer[4] = crc >> 8;
+        reply.length    = 5;
+    }
+    bool is_for_us(const RtuMessage &msg) const {
+        return msg.address() == address || msg.address() == RtuAddress(0);
+    }
+    bool is_poll(const RtuMessage &msg) const {
+        return msg.address() != RtuAddress(0) &&
+               msg.length == indication_length &&
+               !std::memcmp(msg.buffer, indication, msg.length);
+    }
+    void copy_reply(const RtuMessage &msg, RtuMessage &reply) {
+        state = State::IDLE;
+        if (msg.address() == RtuAddress(0)) {
+            reply.length = 0;
+            return;
+        }
+        std::memcpy(reply.buffer, frame, frame_length);
+        reply.length = frame_length;
+    }
+
+  public:
+    DeferredHandler(Handler &handler, RtuAddress address, PeriodUs budget,
+                    FunctionSet deferred = FunctionSet::all())
+        : handler(handler), address(address), budget(budget),
+          deferred(deferred) {
+    }
+    void attach_stats(ModbusStats *s) {
+        if constexpr (HasAttachStats<Handler>::value) {
+            handler.attach_stats(s);
+        }
+    }
+    bool serves(RtuAddress addr) const {
+        return addr == address;
+    }
+    // called by the daemon, see CanDefer.
+    PeriodUs deferred_budget() const {
+        return budget;
+    }
+    bool defer(const RtuMessage &msg, ModbusDaemonQueue &q) {
+        if (!is_for_us(msg) || state == State::RUNNING ||
+            (state == State::DONE && is_poll(msg)) ||
+            !deferred.contains(msg.function_code())) {
+            return false;
+        }
+        std::memcpy(indication, msg.buffer, msg.length);
+        std::memcpy(frame, msg.buffer, msg.length);
+        indication_length = msg.length;
+        frame_length      = msg.length;
+        state             = State::RUNNING;
+        done              = &q;
+        jobs.send(Job(), 0);
+        return true;
+    }
+    void indication_done() {
+        if (state == State::RUNNING) {
+            state = State::DONE;
+        }
+    }
+    // runs the job handed over, waiting up to wait for one. Returns
+    // false if there was none.
+    bool work_once(TickType_t wait = portMAX_DELAY) {
+        Job job;
+        if (!jobs.receive(job, wait)) {
+            return false;
+        }
+        auto msg = RtuMessage(frame, frame_length);
+        handler(msg, msg);
+        frame_length = msg.length;
+        done->send(IndicationDone());
+        return true;
+    }
+    // body of the worker task, it never returns.
+    void work() {
+        while (true) {
+            work_once();
+        }
+    }
+    void operator()(const RtuMessage &msg, RtuMessage &reply) {
+        if (!is_for_us(msg)) {
+            reply.length = 0;
+            return;
+        }
+        if (state == State::RUNNING) {
+            make_exception_reply(RtuExceptionCode::SERVER_DEVICE_BUSY, msg,
+                                 reply);
+            return;
+        }
+        if (state == State::DONE && is_poll(msg)) {
+            copy_reply(msg, reply);
+            return;
+        }
+        state = State::IDLE;
+        handler(msg, reply);
+    }
+};
+
+} // namespace vla
+
+#endif // VLA_DEFERRED_HANDLER_HPP
@@ -0,0 +1,143 @@
+#ifndef VLA_DEVICE_IDENTIFICATION_HPP
+#define VLA_DEVICE_IDENTIFICATION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+namespace vla {
+
+// objects 0x00 to 0x02 are the basic category, up to 0x7f the regular
+// one and from 0x80 on the extended one, whose ids are private.
+enum class DeviceObjectId : uint8_t {
+    VENDOR_NAME           = 0x00,
+    PRODUCT_CODE          = 0x01,
+    MAJOR_MINOR_REVISION  = 0x02,
+    VENDOR_URL            = 0x03,
+    PRODUCT_NAME          = 0x04,
+    MODEL_NAME            = 0x05,
+    USER_APPLICATION_NAME = 0x06
+};
+
+struct DeviceObject {
+    DeviceObjectId id;
+    std::string_view value;
+};
+
+// an object and its {id, length} header must fit in one reply
+constexpr size_t DEVICE_OBJECT_MAX_LENGTH = 244;
+
+/**
+ * Objects laid out as they go in a Read Device Identification (0x2b /
+ * 0x0e) reply, {id, length, value...} one after the other sorted by
+ * id. PduHandlerBase copies whole runs of them into the reply.
+ */
+struct DeviceIdentificationTable {
+    const uint8_t *objects;
+    // where each object starts in objects, plus where the last ends
+    const uint16_t *offsets;
+    uint8_t count;
+    uint8_t conformity_level;
+
+    uint8_t id(uint8_t i) const {
+        return objects[offsets[i]];
+    }
+    uint16_t size(uint8_t i) const {
+        return offsets[i + 1] - offsets[i];
+    }
+    // count if there is no object id
+    uint8_t find(uint8_t object_id) const {
+        uint8_t i = 0;
+        while (i < count && id(i) != object_id) {
+            ++i;
+        }
+        return i;
+    }
+};
+
+template <size_t N>
+constexpr bool are_device_objects_valid(const DeviceObject (&objects)[N]) {
+    for (size_t i = 0; i < N; ++i) {
+        if (objects[i].value.size() > DEVICE_OBJECT_MAX_LENGTH ||
+            (i > 0 && objects[i - 1].id >= objects[i].id)) {
+            return false;
+        }
+    }
+    // the basic category is mandatory
+    return N >= 3 && objects[0].id == DeviceObjectId::VENDOR_NAME &&
+           objects[1].id == DeviceObjectId::PRODUCT_CODE &&
+           objects[2].id == DeviceObjectId::MAJOR_MINOR_REVISION;
+}
+
+/**
+ * Device identification objects declared at compile time. The reply
+ * bytes are built by the compiler and live in flash:
+ *
+ * static constexpr vla::DeviceObject objects[] = {
+ *     {vla::DeviceObjectId::VENDOR_NAME, "VLA"},
+ *     {vla::DeviceObjectId::PRODUCT_CODE, "RTU-1"},
+ *     {vla::DeviceObjectId::MAJOR_MINOR_REVISION, "1.0"},
+ * };
+ * using Identification = vla::DeviceIdentification<objects>;
+ *
+ * and a handler serves them with:
+ *
+ * const vla::DeviceIdentificationTable *device_identification() {
+ *     return &Identification::table;
+ * }
+ */
+template <const auto &Objects> class DeviceIdentification {
+    static_assert(are_device_objects_valid(Objects),
+                  "the objects must be sorted by id, start with the basic "
+                  "ones and be up to DEVICE_OBJECT_MAX_LENGTH long");
+
+    static constexpr size_t COUNT = std::size(Objects);
+    static_assert(COUNT < 0x100, "up to 255 objects");
+
+    static constexpr size_t total_size() {
+        size_t size = 0;
+        for (auto &object : Objects) {
+            size += 2 + object.value.size();
+        }
+        return size;
+    }
+
+    struct Layout {
+        uint8_t objects[total_size()];
+        uint16_t offsets[COUNT + 1];
+    };
+
+    static constexpr Layout make_layout() {
+        Layout layout   = {};
+        uint16_t offset = 0;
+        for (size_t i = 0; i < COUNT; ++i) {
+            auto &object               = Objects[i];
+            layout.offsets[i]          = offset;
+            layout.objects[offset]     = uint8_t(object.id);
+            layout.objects[offset + 1] = uint8_t(object.value.size());
+            for (size_t c = 0; c < object.value.size(); ++c) {
+                layout.objects[offset + 2 + c] = uint8_t(object.value[c]);
+            }
+            offset += 2 + object.value.size();
+        }
+        layout.offsets[COUNT] = offset;
+        return layout;
+    }
+
+    // individual access is always supported, hence 0x80
+    static constexpr uint8_t conformity_level() {
+        auto last = uint8_t(Objects[COUNT - 1].id);
+        return 0x80 | (last >= 0x80 ? 0x03 : last >= 0x03 ? 0x02 : 0x01);
+    }
+
+    static constexpr Layout layout = make_layout();
+
+  public:
+    static constexpr DeviceIdentificationTable table = {
+        layout.objects, layout.offsets, uint8_t(COUNT), conformity_level()};
+};
+
+} // namespace vla
+
+#endif // VLA_DEVICE_IDENTIFICATION_HPP
@@ -0,0 +1,146 @@
+#ifndef VLA_FILE_RECORD_STORE_HPP
+#define VLA_FILE_RECORD_STORE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vla/big_endian.hpp>
+
+namespace vla {
+
+/**
+ * A Modbus file: an array of 16 bit records, or read and write
+ * callbacks for files that are not kept in RAM, such as captures or
+ * flash. Build them with record_file and callback_file.
+ */
+struct RecordFile {
+    using ReadCallback  = bool (*)(uint16_t record, uint16_t record_count,
+                                  RegisterWords words);
+    using WriteCallback = bool (*)(uint16_t record, uint16_t record_count,
+                                   ConstRegisterWords words);
+
+    uint16_t number;
+    uint16_t record_count;
+    bool writable;
+    uint16_t *records;
+    ReadCallback read;
+    WriteCallback write;
+};
+
+template <size_t N>
+constexpr RecordFile record_file(uint16_t number, uint16_t (&records)[N]) {
+    static_assert(N <= 10000, "files hold up to 10000 records");
+    return {number, uint16_t(N), true, records, nullptr, nullptr};
+}
+
+// read only
+template <size_t N>
+constexpr RecordFile record_file(uint16_t number,
+                                 const uint16_t (&records)[N]) {
+    static_assert(N <= 10000, "files hold up to 10000 records");
+    return {number, uint16_t(N), false, const_cast<uint16_t *>(records),
+            nullptr, nullptr};
+}
+
+// read only if write is null
+constexpr RecordFile callback_file(uint16_t number, uint16_t record_count,
+                                   RecordFile::ReadCallback read,
+                                   RecordFile::WriteCallback write = nullptr) {
+    return {number, record_count, write != nullptr, nullptr, read, write};
+}
+
+template <size_t N>
+constexpr bool are_file_numbers_valid(const RecordFile (&files)[N]) {
+    for (size_t i = 0; i < N; ++i) {
+        if (files[i].number == 0) {
+            return false;
+        }
+        for (size_t j = 0; j < i; ++j) {
+            if (files[i].number == files[j].number) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Record store for Read/Write File Record (0x14/0x15), laid out at
+ * compile time like RegisterMap:
+ *
+ * static uint16_t calibration[512];
+ * static constexpr vla::RecordFile files[] = {
+ *     vla::record_file(1, calibration),
+ *     vla::callback_file(2, 4096, read_capture),
+ * };
+ * using Files = vla::FileRecordStore<files>;
+ *
+ * and a handler serves it with:
+ *
+ * bool execute_read_file_record(uint16_t file, uint16_t record,
+ *                               uint16_t record_count,
+ *                               vla::RegisterWords words) {
+ *     return Files::read(file, record, record_count, words);
+ * }
+ */
+template <const auto &Files> class FileRecordStore {
+    static_assert(are_file_numbers_valid(Files),
+                  "file numbers must be unique and not 0");
+
+    static const RecordFile *find(uint16_t number) {
+        for (auto &file : Files) {
+            if (file.number == number) {
+                return &file;
+            }
+        }
+        return nullptr;
+    }
+    static const RecordFile *find(uint16_t number, uint16_t record,
+                                  uint16_t record_count) {
+        auto file = find(number);
+        if (!file || uint32_t(record) + record_count > file->record_count) {
+            return nullptr;
+        }
+        return file;
+    }
+
+  public:
+    static bool is_readable(uint16_t number, uint16_t record,
+                            uint16_t record_count) {
+        return find(number, record, record_count) != nullptr;
+    }
+    static bool is_writable(uint16_t number, uint16_t record,
+                            uint16_t record_count) {
+        auto file = find(number, record, record_count);
+        return file && file->writable;
+    }
+    static bool read(uint16_t number, uint16_t record, uint16_t record_count,
+                     RegisterWords words) {
+        auto file = find(number, record, record_count);
+        if (!file) {
+            return false;
+        }
+        if (file->read) {
+            return file->read(record, record_count, words);
+        }
+        copy_to_big_endian(words.data(), &file->records[record], record_count);
+        return true;
+    }
+    static bool write(uint16_t number, uint16_t record, uint16_t record_count,
+                      ConstRegisterWords words) {
+        auto file = find(number, record, record_count);
+        if (!file || !file->writable) {
+            return false;
+        }
+        if (file->write) {
+            return file->write(record, record_count, words);
+        }
+        copy_from_big_endian(&file->records[record], words.data(),
+                             record_count);
+        return true;
+    }
+};
+
+} // namespace vla
+
+#endif // VLA_FILE_RECORD_STORE_HPP
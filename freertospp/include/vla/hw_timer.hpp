@@ -9,7 +9,7 @@ struct PeriodUs {
     uint32_t us;
     constexpr explicit PeriodUs(uint32_t us) : us(us) {
     }
-    PeriodUs operator-(PeriodUs other) const {
+    constexpr PeriodUs operator-(PeriodUs other) const {
         return PeriodUs{us - other.us};
     }
 };
@@ -68,6 +68,8 @@ using AlarmCb = int64_t (*)(AlarmId, void *);
 
 AlarmId set_alarm(PeriodUs us, AlarmCb, void *data);
 void cancel_alarm(AlarmId id);
+// microseconds since boot, same time base as the alarms
+uint64_t now_us();
 
 } // namespace vla
 
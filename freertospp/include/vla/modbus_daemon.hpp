@@ -2,41 +2,186 @@
 #define VLA_MODBUS_DAEMON
 
 #include <functional>
-#include <variant>
+#include <vla/modbus_daemon_fsm.hpp>
+#include <vla/modbus_stats.hpp>
+#include <vla/rtu_frame.hpp>
 #include <vla/rtu_message.hpp>
+#include <vla/rtu_timing.hpp>
 #include <vla/serial_io.hpp>
 #include <vla/hw_timer.hpp>
 
 namespace vla {
 
+// modbus_daemon takes any callable with this signature, including
+// PduHandlerBase instances. Use this type erased one only when the
+// handler must be chosen at run time: it cannot be inlined.
 using RtuMessageHandler =
     std::function<void(const vla::RtuMessage &, vla::RtuMessage &)>;
 
-struct TimeoutMsg {
-    AlarmId aid;
-    TimeoutMsg(AlarmId aid):aid(aid){}
+// functions of this type are responsible for feeding chars (ReadChar)
+using GetCharsCb = void (*)(ModbusDaemonQueue::SenderIsr *);
+
+/**
+ * How the RX side feeds the daemon. CHARS sends one ReadChar per
+ * received char and leaves the framing to the daemon. FRAMES
+ * assembles the frame on the RX side and sends a single
+ * FrameReceived once the inter frame delay has elapsed.
+ */
+enum class RxMode : uint8_t { CHARS, FRAMES };
+
+/**
+ * RX side of the daemon. Transports push every received char into it
+ * from interrupt (or alarm) context and it forwards them to the daemon
+ * queue according to the RxMode. In FRAMES mode the end of the frame
+ * is detected with a single deadline alarm per frame.
+ *
+ * push and the deadline alarm must not preempt each other. That is the
+ * case when the transport interrupt runs on the same core and with the
+ * same priority as the alarm interrupt, which is the SDK default.
+ */
+class RxSink {
+  public:
+    // pushes whatever chars the transport has already received. It is
+    // called from interrupt context, taskWoken is as for push.
+    using DrainCb = void (*)(RxSink &sink, void *data,
+                             BaseType_t *taskWoken);
+
+  private:
+    ModbusDaemonQueue::SenderIsr q;
+    FramePool &pool;
+    ModbusStats &stats;
+    RxMode mode;
+    PeriodUs inter_frame_delay;
+    FrameAssembler frame;
+    volatile bool deadline_armed = false;
+    DrainCb drain                = nullptr;
+    void *drain_data             = nullptr;
+    static int64_t on_deadline(AlarmId, void *data);
+    void receive(uint64_t when, uint8_t chr, bool error,
+                 BaseType_t *taskWoken);
+
+  public:
+    RxSink(ModbusDaemonQueue &q, FramePool &pool, ModbusStats &stats,
+           RxMode mode, const RtuTiming &timing);
+    RxSink(const RxSink &) = delete;
+    RxSink &operator=(const RxSink &) = delete;
+    void push(uint64_t when, uint8_t chr, BaseType_t *taskWoken = nullptr) {
+        receive(when, chr, false, taskWoken);
+    }
+    // pushes a char the UART reported a framing, parity, break or
+    // overrun error for. The frame it belongs to is discarded.
+    void push_error(uint64_t when, uint8_t chr,
+                    BaseType_t *taskWoken = nullptr) {
+        receive(when, chr, true, taskWoken);
+    }
+    // transports that poll for chars must set a drain callback: it is
+    // called right before deciding that a frame is over so that chars
+    // received since the last poll are taken into account.
+    void set_drain(DrainCb cb, void *data) {
+        drain      = cb;
+        drain_data = data;
+    }
 };
-struct ReadChar {
-    uint64_t when;
-    uint8_t chr;
-    ReadChar() = default;
-    explicit ReadChar(uint64_t w, uint8_t c) : when(w), chr(c) {
+
+/**
+ * Writes through an output manager task such as
+ * vla::serial_io::stdout_manager.
+ */
+class OutputQueueTransport {
+    vla::serial_io::OutputQueue::Sender outq;
+
+  public:
+    OutputQueueTransport(vla::serial_io::OutputQueue::Sender outq)
+        : outq(outq) {
     }
+    void write(const uint8_t *data, uint16_t length, ModbusDaemonQueue &q);
 };
 
-using ModbusDaemonMessage =
-    std::variant<ReadChar, TimeoutMsg, vla::RtuMessage, vla::serial_io::BytesWritten>;
-using ModbusDaemonQueue = vla::Queue<ModbusDaemonMessage>;
+/**
+ * Reads stdin when the stdio drivers report chars available and writes
+ * through an output manager task. stdin is also polled every
+ * MODBUS_STDIO_POLL_PERIOD_US as a fallback for drivers without that
+ * notification.
+ */
+class StdioTransport : public OutputQueueTransport {
+  public:
+    StdioTransport(vla::serial_io::OutputQueue::Sender outq)
+        : OutputQueueTransport(outq) {
+    }
+    void start(RxSink &sink);
+};
 
-// functions of this type are responsible for feeding chars (ReadChar)
-using GetCharsCb = void (*)(ModbusDaemonQueue::SenderIsr *);
+/**
+ * Queue, frame buffers and counters of a daemon. The frame buffers
+ * alone take MODBUS_FRAME_BUFFERS * PDU_MAX bytes, so give the context
+ * static storage rather than putting it on the Modbus task stack. Other
+ * tasks read the counters with stats.snapshot().
+ */
+struct ModbusDaemonContext {
+    ModbusDaemonQueue q{32};
+    FramePool pool;
+    ModbusStats stats;
+};
+
+/**
+ * pool must be the one the RX side feeding q takes the FrameReceived
+ * buffers from, and stats the one it counts its errors in.
+ */
+template <typename Handler>
+void modbus_daemon(ModbusDaemonQueue &q, FramePool &pool,
+                   SerialTransport transport, Handler &handle_indication,
+                   const RtuTiming &timing, ModbusStats &stats,
+                   const AdmissionControl &admission = {}) {
+    ModbusDaemonFsm<Handler> fsm(q, pool, transport, handle_indication,
+                                 timing, stats, admission);
+    while (true) {
+        auto msg = q.receive();
+        fsm.on_message(msg);
+    }
+}
 
-void modbus_daemon(ModbusDaemonQueue &q,
+/**
+ * The RX side must feed context.q, taking its buffers from
+ * context.pool.
+ */
+template <typename Handler>
+void modbus_daemon(ModbusDaemonContext &context,
                    vla::serial_io::OutputQueue::Sender outq,
-                   RtuMessageHandler handle_indication);
+                   Handler &handle_indication,
+                   const RtuTiming &timing = default_rtu_timing) {
+    OutputQueueTransport transport(outq);
+    modbus_daemon(context.q, context.pool, SerialTransport(transport),
+                  handle_indication, timing, context.stats);
+}
+
+/**
+ * Serve handle_indication on transport. It never returns, so it is
+ * meant to be the body of the Modbus task. Pass admission to shed load
+ * when the handler cannot keep up with the bus.
+ */
+template <typename Transport, typename Handler>
+void modbus_daemon(ModbusDaemonContext &context, Transport &transport,
+                   Handler &handle_indication,
+                   RxMode rx_mode                    = RxMode::FRAMES,
+                   const RtuTiming &timing           = default_rtu_timing,
+                   const AdmissionControl &admission = {}) {
+    RxSink sink(context.q, context.pool, context.stats, rx_mode, timing);
+    transport.start(sink);
+    modbus_daemon(context.q, context.pool, SerialTransport(transport),
+                  handle_indication, timing, context.stats, admission);
+}
 
-void modbus_daemon_stdin(vla::serial_io::OutputQueue::Sender outq,
-                         RtuMessageHandler handle_indication);
+template <typename Handler>
+void modbus_daemon_stdin(ModbusDaemonContext &context,
+                         vla::serial_io::OutputQueue::Sender outq,
+                         Handler &handle_indication,
+                         RxMode rx_mode                    = RxMode::CHARS,
+                         const RtuTiming &timing           = default_rtu_timing,
+                         const AdmissionControl &admission = {}) {
+    StdioTransport transport(outq);
+    modbus_daemon(context, transport, handle_indication, rx_mode, timing,
+                  admission);
+}
 
 } // namespace vla
 
@@ -0,0 +1,728 @@
+#ifndef VLA_MODBUS_DAEMON_FSM_HPP
+#define VLA_MODBUS_DAEMON_FSM_HPP
+
+#include <mp/fsm.h>
+#include <optional>
+#include <type_traits>
+#include <variant>
+#include <vla/crc16.hpp>
+#include <vla/hw_timer.hpp>
+#include <vla/modbus_stats.hpp>
+#include <vla/rtu_frame.hpp>
+#include <vla/rtu_message.hpp>
+#include <vla/rtu_timing.hpp>
+#include <vla/serial_io.hpp>
+
+namespace vla {
+
+struct TimeoutMsg {
+    AlarmId aid;
+    // time at which the alarm fired
+    uint64_t when;
+    TimeoutMsg(AlarmId aid, uint64_t when) : aid(aid), when(when) {
+    }
+};
+struct ReadChar {
+    uint64_t when;
+    uint8_t chr;
+    // the UART reported a framing, parity, break or overrun error
+    bool error = false;
+    ReadChar() = default;
+    explicit ReadChar(uint64_t w, uint8_t c, bool e = false)
+        : when(w), chr(c), error(e) {
+    }
+};
+// sent by a handler that finishes indications in another task once the
+// reply is ready, see DeferredHandler.
+struct IndicationDone {};
+
+using ModbusDaemonMessage =
+    std::variant<ReadChar, FrameReceived, TimeoutMsg,
+                 vla::serial_io::BytesWritten, IndicationDone>;
+using ModbusDaemonQueue = vla::Queue<ModbusDaemonMessage>;
+
+/**
+ * Transports connect the daemon to a serial line. Any type with these
+ * two members can be used:
+ *
+ * // start pushing the received chars into sink. Called once, before
+ * // the daemon starts.
+ * void start(RxSink &sink);
+ * // write length bytes from data and send BytesWritten to q once
+ * // they are out. data remains valid until then.
+ * void write(const uint8_t *data, uint16_t length, ModbusDaemonQueue &q);
+ *
+ * SerialTransport is a non owning handle to any of them so the daemon
+ * itself does not depend on the transport type.
+ */
+class SerialTransport {
+    using WriteCb = void (*)(void *transport, const uint8_t *data,
+                             uint16_t length, ModbusDaemonQueue &q);
+    void *transport;
+    WriteCb write_cb;
+
+  public:
+    // not a candidate for copies, which must copy the erased transport
+    // rather than wrap the SerialTransport itself.
+    template <typename Transport,
+              typename = std::enable_if_t<
+                  !std::is_same_v<Transport, SerialTransport>>>
+    explicit SerialTransport(Transport &t) : transport(&t) {
+        write_cb = [](void *t, const uint8_t *data, uint16_t length,
+                      ModbusDaemonQueue &q) {
+            static_cast<Transport *>(t)->write(data, length, q);
+        };
+    }
+    void write(const uint8_t *data, uint16_t length, ModbusDaemonQueue &q) {
+        write_cb(transport, data, length, q);
+    }
+};
+
+// arm an alarm that sends TimeoutMsg to q once us have elapsed
+AlarmId set_alarm(ModbusDaemonQueue &q, PeriodUs us);
+
+inline bool must_transmit(const RtuMessage &msg) {
+    return msg.length > 0;
+}
+
+enum class OverloadPolicy : uint8_t { BUSY, DROP };
+
+/**
+ * Limits on the work the daemon takes on. An indication is refused,
+ * without calling the handler, if by the time the daemon gets to it
+ * more than deadline has elapsed since its last char or more than
+ * max_queued messages wait in the daemon queue behind it: chars in
+ * RxMode::CHARS, frames in RxMode::FRAMES. A limit of 0 is not
+ * checked.
+ *
+ * With the BUSY policy refused indications are answered with
+ * SERVER_DEVICE_BUSY, which is cheap and tells the master to back off.
+ * Only those for an address the handler serves (see HasServes) are:
+ * broadcasts, and all of them with DROP or a handler that cannot tell,
+ * get no reply. Frames for other slaves are not refused, they are just
+ * not for us. Keep the deadline below the master response timeout,
+ * later replies are wasted.
+ */
+struct AdmissionControl {
+    PeriodUs deadline     = PeriodUs(0);
+    uint16_t max_queued   = 0;
+    OverloadPolicy policy = OverloadPolicy::DROP;
+};
+
+// events:
+// ReadChar, FrameReceived, TimeoutMsg, vla::RtuMessage,
+// vla::serial_io::BytesWritten, IndicationDone, MdeDeferredDeadline
+struct MdeStart {};
+// the budget of a deferred indication has elapsed
+struct MdeDeferredDeadline {};
+struct MdsStart {};
+struct MdsInitial {};
+struct MdsReady {};
+struct MdsReception {
+    // nullptr if the pool had no free buffer, the frame is discarded
+    uint8_t *buffer;
+    uint16_t buffer_i = 0;
+    // chars received, stored or not
+    uint16_t chars = 0;
+    uint16_t crc   = crc16::INIT;
+    // cleared when the frame must be discarded: an inter char gap
+    // longer than the inter char delay, a char with a line error, a
+    // frame longer than PDU_MAX or no buffer to hold it.
+    bool valid = true;
+    MdsReception(uint8_t *buffer) : buffer(buffer), valid(buffer) {
+    }
+    void append_char(uint8_t chr) {
+        if (chars < UINT16_MAX) {
+            ++chars;
+        }
+        if (valid && buffer_i < PDU_MAX) {
+            buffer[buffer_i++] = chr;
+            crc                = crc16::update(crc, chr);
+        } else {
+            valid = false;
+        }
+    }
+};
+// the reply is waiting for the bus to be silent for the inter frame
+// delay.
+struct MdsProcessing {
+    RtuMessage rtu_msg;
+    // arrival time of the last char of the indication
+    uint64_t indication_end;
+    MdsProcessing(RtuMessage m, uint64_t end)
+        : rtu_msg(m), indication_end(end) {
+    }
+};
+// the reply is waiting for the previous one to be written out.
+struct MdsTxPending {
+    RtuMessage rtu_msg;
+    uint64_t indication_end;
+    MdsTxPending(RtuMessage m, uint64_t end)
+        : rtu_msg(m), indication_end(end) {
+    }
+};
+
+// handlers with an attach_stats(ModbusStats *) member get the daemon
+// counters, PduHandlerBase uses them to answer the diagnostics
+// function codes.
+template <typename Handler>
+using AttachStatsCall = decltype(std::declval<Handler &>().attach_stats(
+    std::declval<ModbusStats *>()));
+template <typename Handler, typename = void>
+struct HasAttachStats : std::false_type {};
+template <typename Handler>
+struct HasAttachStats<Handler, std::void_t<AttachStatsCall<Handler>>>
+    : std::true_type {};
+
+// handlers with a serves(address) member tell the unicast addresses
+// they answer. PduHandlerBase serves the one it was built for.
+template <typename Handler>
+using ServesCall = decltype(std::declval<Handler &>().serves(
+    std::declval<RtuAddress>()));
+template <typename Handler, typename = void>
+struct HasServes : std::false_type {};
+template <typename Handler>
+struct HasServes<Handler, std::void_t<ServesCall<Handler>>>
+    : std::true_type {};
+
+// handlers with a defer(indication, q) member may hand indications
+// over to another task. defer returns false for those to be handled
+// right away. For the others the handler sends IndicationDone to q once
+// the reply is ready. The daemon then calls indication_done() and
+// calls the handler again with the same indication to collect the
+// reply. If deferred_budget() elapses first the master gets
+// ACKNOLEDGE instead.
+template <typename Handler>
+using DeferCall = decltype(std::declval<Handler &>().defer(
+    std::declval<const RtuMessage &>(), std::declval<ModbusDaemonQueue &>()));
+template <typename Handler, typename = void>
+struct CanDefer : std::false_type {};
+template <typename Handler>
+struct CanDefer<Handler, std::void_t<DeferCall<Handler>>> : std::true_type {
+};
+
+using ModbusDaemonState =
+    std::variant<MdsStart, MdsInitial, MdsReady, MdsReception, MdsProcessing,
+                 MdsTxPending>;
+
+/**
+ * Framing is computed from the ReadChar arrival timestamps. There is
+ * at most one alarm armed at any time: it is set for the end of frame
+ * deadline when the first char arrives and, if more chars have
+ * arrived by the time it fires, it is rearmed for the new deadline.
+ * Chars never touch the hardware timer.
+ *
+ * Every frame lives in its own FramePool buffer and the reply is built
+ * in place. Writing a reply does not block the daemon: it goes back to
+ * MdsReady right away and the buffer is released when BytesWritten
+ * arrives, so the next frame can be received and handled meanwhile.
+ * Only the write of its reply waits for the previous one to finish.
+ *
+ * Handler is called as handle_indication(indication, reply). It is
+ * bound by reference and called directly, so the whole PDU path can
+ * be inlined into the daemon.
+ *
+ * An indication deferred to another task (see CanDefer) keeps its
+ * buffer while the daemon goes back to MdsReady and keeps tracking the
+ * bus. It is answered from MdsReady once IndicationDone arrives or its
+ * budget elapses, whichever comes first. Any frame received meanwhile
+ * means that the master has given up on it, so it is not answered at
+ * all. The handler keeps the result for the master to poll.
+ */
+template <typename Handler>
+class ModbusDaemonFsm
+    : public mp::fsm<ModbusDaemonFsm<Handler>, ModbusDaemonState> {
+    ModbusDaemonQueue &q;
+    FramePool &pool;
+    SerialTransport transport;
+    Handler &handle_indication;
+    const RtuTiming timing;
+    // the only alarm that may be pending
+    AlarmId alarm;
+    // the deadline of the last alarm had passed by the time it was
+    // set: set_alarm ran the callback right away, or was not called,
+    // and returned no id to match its TimeoutMsg against. on_message
+    // delivers the timeout itself.
+    bool timeout_due = false;
+    // arrival time of the last char seen on the bus
+    uint64_t last_activity = 0;
+    // the reply being written, nullptr if the transport is idle
+    uint8_t *tx_buffer = nullptr;
+    ModbusStats &stats;
+    const AdmissionControl admission;
+    struct DeferredIndication {
+        RtuMessage msg;
+        uint64_t indication_end;
+    };
+    // the indication handed over to another task, waiting for its
+    // reply.
+    std::optional<DeferredIndication> deferred;
+    // the budget alarm of deferred, and whether it was due when set as
+    // for timeout_due.
+    AlarmId deferred_alarm;
+    bool deferred_due = false;
+
+    void arm_alarm(PeriodUs us) {
+        if (alarm) {
+            cancel_alarm(alarm);
+        }
+        alarm       = us.us ? set_alarm(q, us) : AlarmId();
+        timeout_due = !alarm;
+    }
+    // time left until the bus has been silent for the inter frame
+    // delay, zero if it already has.
+    PeriodUs silence_left(uint64_t now) const {
+        auto deadline = last_activity + timing.inter_frame_delay.us;
+        return PeriodUs(deadline > now ? deadline - now : 0);
+    }
+    // arm the alarm so that it fires once the bus has been silent for
+    // the inter frame delay.
+    void arm_end_of_frame() {
+        arm_alarm(silence_left(now_us()));
+    }
+    bool is_end_of_frame(const TimeoutMsg &tout) const {
+        return !silence_left(tout.when).us;
+    }
+    MdsInitial enter_initial() {
+        last_activity = now_us();
+        arm_alarm(timing.inter_frame_delay);
+        return MdsInitial();
+    }
+    // give back the buffers held by states and events that are
+    // abandoned.
+    void discard(const MdsReception &state) {
+        if (state.buffer) {
+            pool.release(state.buffer);
+        }
+    }
+    void discard(const MdsProcessing &state) {
+        pool.release(state.rtu_msg.buffer);
+    }
+    void discard(const MdsTxPending &state) {
+        pool.release(state.rtu_msg.buffer);
+    }
+    void discard(const FrameReceived &frame) {
+        pool.release(frame.buffer);
+    }
+    template <typename T> void discard(const T &) {
+    }
+    std::optional<ModbusDaemonState> transmit(const RtuMessage &msg,
+                                              uint64_t indication_end) {
+        if (tx_buffer) {
+            return MdsTxPending(msg, indication_end);
+        }
+        tx_buffer = msg.buffer;
+        transport.write(msg.buffer, msg.length, q);
+        stats.turnaround.add(now_us() - indication_end);
+        return MdsReady();
+    }
+    // turn the indication into an exception reply, in place.
+    void make_exception_reply(RtuMessage &msg, RtuExceptionCode code) {
+        auto function = msg.function_code();
+        msg.buffer[1] = uint8_t(function) | 0x80;
+        msg.buffer[2] = uint8_t(code);
+        auto crc      = crc16::compute(msg.buffer, 3);
+        msg.buffer[3] = crc;
+        msg.buffer[4] = crc >> 8;
+        msg.length    = 5;
+        count_reply(msg, function, false);
+    }
+    void count_reply(const RtuMessage &reply, RtuFunctionCode function,
+                     bool broadcast) {
+        // wrappers such as UnitDispatcher leave no reply at all for a
+        // broadcast they have handled.
+        if (!broadcast && !must_transmit(reply)) {
+            // not for us
+            return;
+        }
+        bool exception = must_transmit(reply) && reply.buffer[1] & 0x80;
+        if (!exception && function != RtuFunctionCode::GET_COM_EVENT_COUNTER) {
+            ++stats.comm_events;
+        }
+        if (broadcast) {
+            ++stats.broadcasts;
+            return;
+        }
+        if (exception) {
+            ++stats.exceptions[reply.buffer[2] & 0x0f];
+        }
+        ++stats.replies;
+    }
+    // handle the indication and send the reply as soon as the bus has
+    // been silent for the inter frame delay since the last char of the
+    // indication. By the time the end of the frame is detected that
+    // is usually already the case, so the reply goes out right away.
+    // Broadcasts are handled but never answered.
+    std::optional<ModbusDaemonState>
+    process_indication(uint8_t *indication, uint16_t length,
+                       uint64_t indication_end) {
+        auto msg       = RtuMessage(indication, length);
+        auto function  = msg.function_code();
+        auto broadcast = msg.address() == RtuAddress(0);
+        auto start     = now_us();
+        if (defer(msg, indication_end)) {
+            stats.handler_time.add(now_us() - start);
+            if (broadcast) {
+                msg.length = 0;
+                count_reply(msg, function, broadcast);
+                pool.release(indication);
+            }
+            return MdsReady();
+        }
+        handle_indication(msg, msg);
+        stats.handler_time.add(now_us() - start);
+        count_reply(msg, function, broadcast);
+        if (broadcast || !must_transmit(msg)) {
+            pool.release(indication);
+            return MdsReady();
+        }
+        return reply(msg, indication_end);
+    }
+    // hand the indication over to the handler's worker if it takes it.
+    // Broadcasts are never answered, so only the others are kept.
+    bool defer(const RtuMessage &msg, uint64_t indication_end) {
+        if constexpr (CanDefer<Handler>::value) {
+            if (!handle_indication.defer(msg, q)) {
+                return false;
+            }
+            if (msg.address() != RtuAddress(0)) {
+                auto budget    = handle_indication.deferred_budget();
+                deferred       = DeferredIndication{msg, indication_end};
+                deferred_alarm = budget.us ? set_alarm(q, budget) : AlarmId();
+                deferred_due   = !deferred_alarm;
+            }
+            return true;
+        } else {
+            return false;
+        }
+    }
+    // the deferred indication will not be answered, any reply still to
+    // come is left to the master to poll.
+    void abandon_deferred() {
+        if (!deferred) {
+            return;
+        }
+        if (deferred_alarm) {
+            cancel_alarm(deferred_alarm);
+        }
+        deferred_alarm = AlarmId();
+        deferred_due   = false;
+        pool.release(deferred->msg.buffer);
+        deferred.reset();
+    }
+    // answer the deferred indication with the reply of the handler, or
+    // with ACKNOLEDGE if it is not ready.
+    std::optional<ModbusDaemonState> reply_deferred(bool ready) {
+        auto pending = *deferred;
+        auto &msg    = pending.msg;
+        deferred.reset();
+        if (deferred_alarm) {
+            cancel_alarm(deferred_alarm);
+        }
+        deferred_alarm = AlarmId();
+        deferred_due   = false;
+        if (!ready) {
+            make_exception_reply(msg, RtuExceptionCode::ACKNOLEDGE);
+            return reply(msg, pending.indication_end);
+        }
+        auto function = msg.function_code();
+        handle_indication(msg, msg);
+        count_reply(msg, function, false);
+        if (!must_transmit(msg)) {
+            pool.release(msg.buffer);
+            return MdsReady();
+        }
+        return reply(msg, pending.indication_end);
+    }
+    std::optional<ModbusDaemonState> reply(const RtuMessage &msg,
+                                           uint64_t indication_end) {
+        auto left = silence_left(now_us());
+        if (left.us) {
+            arm_alarm(left);
+            return MdsProcessing(msg, indication_end);
+        }
+        return transmit(msg, indication_end);
+    }
+    bool is_overloaded(uint64_t indication_end) const {
+        return (admission.deadline.us &&
+                now_us() - indication_end > admission.deadline.us) ||
+               (admission.max_queued &&
+                q.messages_waiting() > admission.max_queued);
+    }
+    // whether the handler answers address. Handlers that cannot tell
+    // are taken to answer them all.
+    bool is_served(RtuAddress address) {
+        if constexpr (HasServes<Handler>::value) {
+            return address == RtuAddress(0) ||
+                   handle_indication.serves(address);
+        } else {
+            return true;
+        }
+    }
+    // answer SERVER_DEVICE_BUSY in place or drop the indication, as
+    // the policy says.
+    std::optional<ModbusDaemonState>
+    refuse_indication(uint8_t *indication, uint16_t length,
+                      uint64_t indication_end) {
+        auto msg = RtuMessage(indication, length);
+        if (!is_served(msg.address())) {
+            // for another slave, there was nothing to refuse
+            pool.release(indication);
+            return MdsReady();
+        }
+        if (admission.policy == OverloadPolicy::DROP ||
+            msg.address() == RtuAddress(0) || !HasServes<Handler>::value) {
+            ++stats.overload_drops;
+            pool.release(indication);
+            return MdsReady();
+        }
+        ++stats.overload_busy;
+        make_exception_reply(msg, RtuExceptionCode::SERVER_DEVICE_BUSY);
+        return reply(msg, indication_end);
+    }
+    // the TimeoutMsg of an alarm that fired while being set, if any,
+    // is stale by the time it is received.
+    void dispatch_due() {
+        while (timeout_due || deferred_due) {
+            if (timeout_due) {
+                timeout_due = false;
+                this->dispatch(TimeoutMsg(AlarmId(), now_us()));
+            } else {
+                deferred_due = false;
+                this->dispatch(MdeDeferredDeadline());
+            }
+        }
+    }
+    // corrupted frames are dropped before they reach the handler.
+    std::optional<ModbusDaemonState> process_frame(const FrameReceived &frame) {
+        ++stats.frames_received;
+        if (!frame.is_intact()) {
+            ++stats.crc_errors;
+            discard(frame);
+            return MdsReady();
+        }
+        if (is_overloaded(frame.last)) {
+            return refuse_indication(frame.buffer, frame.length, frame.last);
+        }
+        return process_indication(frame.buffer, frame.length, frame.last);
+    }
+
+  public:
+    ModbusDaemonFsm(ModbusDaemonQueue &q, FramePool &pool,
+                    SerialTransport transport, Handler &h,
+                    const RtuTiming &timing, ModbusStats &stats,
+                    const AdmissionControl &admission = {})
+        : q(q), pool(pool), transport(transport), handle_indication(h),
+          timing(timing), stats(stats), admission(admission) {
+        if constexpr (HasAttachStats<Handler>::value) {
+            handle_indication.attach_stats(&stats);
+        }
+        this->dispatch(MdeStart());
+    }
+
+    void on_message(ModbusDaemonMessage &msg) {
+        if (auto tout = std::get_if<TimeoutMsg>(&msg)) {
+            if (deferred_alarm && tout->aid == deferred_alarm) {
+                deferred_alarm = AlarmId();
+                deferred_due   = true;
+                dispatch_due();
+                return;
+            }
+            // an alarm may fire while it is being cancelled or
+            // replaced, leaving a stale TimeoutMsg in the queue.
+            if (!alarm || tout->aid != alarm) {
+                return;
+            }
+            alarm = AlarmId();
+        } else if (std::holds_alternative<serial_io::BytesWritten>(msg)) {
+            // the transport is done with the reply in whatever state
+            // the daemon is.
+            if (!tx_buffer) {
+                return;
+            }
+            pool.release(tx_buffer);
+            tx_buffer = nullptr;
+        } else if (std::holds_alternative<IndicationDone>(msg)) {
+            // the handler learns that its worker is done in whatever
+            // state the daemon is.
+            if constexpr (CanDefer<Handler>::value) {
+                handle_indication.indication_done();
+            }
+        }
+        std::visit([this](auto &event) { this->dispatch(event); }, msg);
+        dispatch_due();
+    }
+
+    template <typename State, typename Event>
+    auto on_event(State &state, const Event &event) {
+        // unexpected event
+        discard(state);
+        discard(event);
+        return enter_initial();
+    }
+    template <typename State>
+    auto on_event(State &, const serial_io::BytesWritten &) {
+        return std::nullopt;
+    }
+    // the deferred indication is only answered from MdsReady
+    template <typename State>
+    auto on_event(State &, const IndicationDone &) {
+        abandon_deferred();
+        return std::nullopt;
+    }
+    template <typename State>
+    auto on_event(State &, const MdeDeferredDeadline &) {
+        abandon_deferred();
+        return std::nullopt;
+    }
+
+    /*
+     * STATE MdsStart
+     */
+    auto on_event(MdsStart &, const MdeStart &evt) {
+        return enter_initial();
+    }
+
+    /*
+     * STATE MdsInitial
+     */
+    auto on_event(MdsInitial &, const ReadChar &msg) {
+        // ignore chars in this state, they just push the deadline
+        last_activity = msg.when;
+        return std::nullopt;
+    }
+    std::optional<ModbusDaemonState> on_event(MdsInitial &,
+                                              const TimeoutMsg tout) {
+        if (!is_end_of_frame(tout)) {
+            arm_end_of_frame();
+            return std::nullopt;
+        }
+        return MdsReady();
+    }
+    // a frame that was already on its way when the daemon went back
+    // to waiting for a silent line, from MdsTxPending. It may be the
+    // tail of one shed meanwhile, so it is dropped too.
+    auto on_event(MdsInitial &, const FrameReceived &frame) {
+        ++stats.frames_received;
+        stats.count_dropped(0, frame.length);
+        discard(frame);
+        last_activity = frame.last;
+        return std::nullopt;
+    }
+
+    /*
+     * STATE MdsReady
+     */
+    auto on_event(MdsReady &, const ReadChar input_msg) {
+        abandon_deferred();
+        auto new_state = MdsReception(pool.acquire());
+        new_state.append_char(input_msg.chr);
+        if (input_msg.error) {
+            new_state.valid = false;
+        }
+        last_activity = input_msg.when;
+        arm_end_of_frame();
+        return new_state;
+    }
+    std::optional<ModbusDaemonState> on_event(MdsReady &,
+                                              const FrameReceived &frame) {
+        // the RX side has already waited for the inter frame delay
+        last_activity = frame.last;
+        abandon_deferred();
+        return process_frame(frame);
+    }
+    std::optional<ModbusDaemonState> on_event(MdsReady &,
+                                              const IndicationDone &) {
+        if (!deferred) {
+            return std::nullopt;
+        }
+        return reply_deferred(true);
+    }
+    std::optional<ModbusDaemonState> on_event(MdsReady &,
+                                              const MdeDeferredDeadline &) {
+        if (!deferred) {
+            return std::nullopt;
+        }
+        return reply_deferred(false);
+    }
+
+    /*
+     * STATE MdsReception
+     */
+    auto on_event(MdsReception &state, const ReadChar input_msg) {
+        if (input_msg.error ||
+            input_msg.when - last_activity > timing.inter_char_delay.us) {
+            state.valid = false;
+        }
+        state.append_char(input_msg.chr);
+        last_activity = input_msg.when;
+        return std::nullopt;
+    }
+    std::optional<ModbusDaemonState> on_event(MdsReception &state,
+                                              const TimeoutMsg tout) {
+        // chars that arrived before the alarm fired are already
+        // queued ahead of it, so the frame is over only if none of
+        // them is within the inter frame delay of tout.when.
+        if (!is_end_of_frame(tout)) {
+            arm_end_of_frame();
+            return std::nullopt;
+        }
+        if (!state.valid) {
+            stats.count_dropped(1, state.chars);
+            discard(state);
+            return MdsReady();
+        }
+        return process_frame(FrameReceived{state.buffer, state.buffer_i,
+                                           state.crc, 0, last_activity});
+    }
+
+    /*
+     * STATE MdsProcessing
+     */
+    std::optional<ModbusDaemonState> on_event(MdsProcessing &state,
+                                              const TimeoutMsg) {
+        return transmit(state.rtu_msg, state.indication_end);
+    }
+
+    /*
+     * STATE MdsTxPending
+     */
+    std::optional<ModbusDaemonState> on_event(MdsTxPending &state,
+                                              const serial_io::BytesWritten &) {
+        auto next = transmit(state.rtu_msg, state.indication_end);
+        // the rest of a frame dropped meanwhile may still be coming,
+        // wait for the line to go silent before taking new ones.
+        if (silence_left(now_us()).us) {
+            arm_end_of_frame();
+            return MdsInitial();
+        }
+        return next;
+    }
+    // there is no room for a third reply, shed the new frame rather
+    // than the one already handled.
+    std::optional<ModbusDaemonState> on_event(MdsTxPending &,
+                                              const FrameReceived &frame) {
+        ++stats.frames_received;
+        if (frame.length && is_served(RtuAddress(frame.buffer[0]))) {
+            ++stats.overload_drops;
+        }
+        discard(frame);
+        return std::nullopt;
+    }
+    // same in RxMode::CHARS, where the chars are shed as they come.
+    std::optional<ModbusDaemonState> on_event(MdsTxPending &,
+                                              const ReadChar &input_msg) {
+        if (!silence_left(input_msg.when).us &&
+            is_served(RtuAddress(input_msg.chr))) {
+            // first char of a frame, its address
+            ++stats.overload_drops;
+        }
+        stats.count_dropped(0, 1);
+        last_activity = input_msg.when;
+        return std::nullopt;
+    }
+};
+
+} // namespace vla
+
+#endif // VLA_MODBUS_DAEMON_FSM_HPP
@@ -0,0 +1,104 @@
+#ifndef VLA_MODBUS_STATS_HPP
+#define VLA_MODBUS_STATS_HPP
+
+#include <FreeRTOS.h>
+#include <cstdint>
+#include <task.h>
+
+namespace vla {
+
+/**
+ * Fixed bucket histogram of durations in microseconds. Bucket i counts
+ * the samples up to BOUNDS_US[i], the last one those above all the
+ * bounds.
+ */
+struct LatencyHistogram {
+    static constexpr uint32_t BOUNDS_US[] = {50,   100,  200,   500,  1000,
+                                             2000, 5000, 10000, 20000};
+    static constexpr int BUCKETS = sizeof(BOUNDS_US) / sizeof(uint32_t) + 1;
+    uint32_t buckets[BUCKETS] = {};
+    uint32_t count            = 0;
+    uint32_t max_us           = 0;
+    uint64_t total_us         = 0;
+
+    void add(uint32_t us) {
+        int i = 0;
+        while (i < BUCKETS - 1 && us > BOUNDS_US[i]) {
+            ++i;
+        }
+        ++buckets[i];
+        ++count;
+        total_us += us;
+        if (us > max_us) {
+            max_us = us;
+        }
+    }
+};
+
+/**
+ * Counters kept by modbus_daemon. The daemon task updates them, except
+ * framing_errors, bytes_dropped and queue_overflows, which the RX side
+ * updates from interrupt context and the daemon task through
+ * count_dropped. Other tasks must read them through snapshot.
+ */
+struct ModbusStats {
+    // frames that reached the daemon, whatever their CRC
+    uint32_t frames_received = 0;
+    uint32_t crc_errors      = 0;
+    // frames discarded because of an inter char gap longer than t1.5,
+    // a line error, a length over PDU_MAX or no free frame buffer
+    uint32_t framing_errors = 0;
+    // chars of the frames discarded before reaching the daemon
+    uint32_t bytes_dropped = 0;
+    // chars or frames lost because the daemon queue was full
+    uint32_t queue_overflows = 0;
+    // indexed by RtuExceptionCode
+    uint32_t exceptions[16] = {};
+    uint32_t broadcasts     = 0;
+    uint32_t replies        = 0;
+    // successful message completions as reported by Get Comm Event
+    // Counter (0x0b)
+    uint32_t comm_events = 0;
+    // retries answered by a ReplyCache
+    uint32_t reply_cache_hits = 0;
+    // indications refused by AdmissionControl, answered with
+    // SERVER_DEVICE_BUSY or dropped without a reply
+    uint32_t overload_busy  = 0;
+    uint32_t overload_drops = 0;
+    // from the arrival of the last char of an indication until its
+    // reply is handed to the transport
+    LatencyHistogram turnaround;
+    // time spent in the handler
+    LatencyHistogram handler_time;
+
+    // for the daemon task: the RX interrupts update the same counters,
+    // and a plain increment would lose theirs if one came in between.
+    void count_dropped(uint32_t frames, uint32_t chars) {
+        taskENTER_CRITICAL();
+        framing_errors += frames;
+        bytes_dropped += chars;
+        taskEXIT_CRITICAL();
+    }
+    uint32_t exceptions_sent() const {
+        uint32_t total = 0;
+        for (auto count : exceptions) {
+            total += count;
+        }
+        return total;
+    }
+    ModbusStats snapshot() const {
+        taskENTER_CRITICAL();
+        auto copy = *this;
+        taskEXIT_CRITICAL();
+        return copy;
+    }
+    void clear() {
+        taskENTER_CRITICAL();
+        *this = ModbusStats();
+        taskEXIT_CRITICAL();
+    }
+};
+
+} // namespace vla
+
+#endif // VLA_MODBUS_STATS_HPP
@@ -2,7 +2,11 @@
 #define VLA_PDU_HANDLER_BASE
 
 #include <cstring>
+#include <type_traits>
+#include <vla/big_endian.hpp>
 #include <vla/crc16.h>
+#include <vla/device_identification.hpp>
+#include <vla/modbus_stats.hpp>
 #include <vla/rtu_message.hpp>
 
 namespace vla {
@@ -24,6 +28,27 @@ inline uint16_t fix_endianess(uint16_t v) {
 }
 #endif
 
+// PduHandler::SUPPORTED_FUNCTIONS if declared, all functions otherwise
+template <class PduHandler, typename = void> struct SupportedFunctions {
+    static constexpr FunctionSet value = FunctionSet::all();
+};
+
+template <class PduHandler>
+struct SupportedFunctions<
+    PduHandler, std::void_t<decltype(PduHandler::SUPPORTED_FUNCTIONS)>> {
+    static constexpr FunctionSet value = PduHandler::SUPPORTED_FUNCTIONS;
+};
+
+/**
+ * Handlers can declare the function codes they serve at compile time:
+ *
+ * static constexpr vla::FunctionSet SUPPORTED_FUNCTIONS =
+ *     vla::RtuFunctionCode::READ_HOLDING_REGISTERS |
+ *     vla::RtuFunctionCode::WRITE_MULTIPLE_REGISTERS;
+ *
+ * The code for the others is then left out of the binary. The
+ * is_*_supported hooks still decide at run time within that set.
+ */
 template <class PduHandler> class PduHandlerBase {
   public:
     PduHandlerBase(RtuAddress address) : address(address) {
@@ -39,6 +64,19 @@ template <class PduHandler> class PduHandlerBase {
             reply.length = 0;
         }
     }
+    // so that handlers can be given to modbus_daemon as they are.
+    void operator()(const RtuMessage &indication, RtuMessage &reply) {
+        handle_indication(indication, reply);
+    }
+    // called by modbus_daemon with its counters, which are then
+    // reported through DIAGNOSTIC and GET_COM_EVENT_COUNTER.
+    void attach_stats(ModbusStats *s) {
+        stats = s;
+    }
+    // the unit address answered, besides broadcasts.
+    bool serves(RtuAddress addr) const {
+        return addr == address;
+    }
     PduHandler &self() {
         return *static_cast<PduHandler *>(this);
     }
@@ -62,15 +100,54 @@ template <class PduHandler> class PduHandlerBase {
     bool execute_read_single_coil(uint16_t address, bool *bit_value) {
         return false;
     }
+    bool execute_read_discrete_inputs(uint16_t address, uint16_t bit_count,
+                                      uint8_t *bytes) {
+        for (uint16_t i = 0; i < bit_count / 8 + uint16_t(bool(bit_count % 8));
+             ++i) {
+            bytes[i] = 0;
+        }
+        for (uint16_t i = 0; i < bit_count; ++i) {
+            bool bit_value = 0;
+            if (!self().execute_read_single_discrete_input(address + i,
+                                                           &bit_value)) {
+                return false;
+            }
+            bytes[i / 8] |= uint8_t(bit_value) << (i % 8);
+        }
+        return true;
+    }
+    bool execute_read_single_discrete_input(uint16_t address,
+                                            bool *bit_value) {
+        return false;
+    }
+    // the register hooks work in place on the PDU, words[i] reads or
+    // assigns register address + i.
     bool execute_read_registers(uint16_t address, uint16_t register_count,
-                                uint16_t *words) {
+                                RegisterWords words) {
+        for (uint16_t i = 0; i < register_count; ++i) {
+            uint16_t v;
+            if (!self().execute_read_single_register(address + i, &v)) {
+                return false;
+            }
+            words[i] = v;
+        }
+        return true;
+    }
+    bool execute_read_input_registers(uint16_t address,
+                                      uint16_t register_count,
+                                      RegisterWords words) {
         for (uint16_t i = 0; i < register_count; ++i) {
-            if (!self().execute_read_single_register(address + i, &words[i])) {
+            uint16_t v;
+            if (!self().execute_read_single_input_register(address + i, &v)) {
                 return false;
             }
+            words[i] = v;
         }
         return true;
     }
+    bool execute_read_single_input_register(uint16_t address, uint16_t *w) {
+        return false;
+    }
     bool execute_write_coils(uint16_t address, const uint8_t *bits,
                              uint16_t bit_count) {
         for (uint16_t i = 0; i < bit_count; ++i) {
@@ -81,7 +158,7 @@ template <class PduHandler> class PduHandlerBase {
         }
         return true;
     }
-    bool execute_write_registers(uint16_t address, uint16_t *words,
+    bool execute_write_registers(uint16_t address, ConstRegisterWords words,
                                  uint8_t word_count) {
         for (uint16_t i = 0; i < word_count; ++i) {
             if (!self().execute_write_single_register(address + i, words[i])) {
@@ -90,9 +167,37 @@ template <class PduHandler> class PduHandlerBase {
         }
         return true;
     }
+    // goes through the bulk hooks, which both kinds of register
+    // handlers serve. Not atomic, handlers whose registers are shared
+    // with other tasks should override it.
+    bool execute_mask_write_register(uint16_t address, uint16_t and_mask,
+                                     uint16_t or_mask) {
+        uint8_t bytes[2];
+        if (!self().execute_read_registers(address, 1, RegisterWords(bytes))) {
+            return false;
+        }
+        uint16_t v = read_big_endian(bytes);
+        write_big_endian(bytes, (v & and_mask) | (or_mask & ~and_mask));
+        return self().execute_write_registers(address,
+                                              ConstRegisterWords(bytes), 1);
+    }
+    // file records are 16 bit words, words[i] is record record + i of
+    // the file.
+    bool execute_read_file_record(uint16_t file, uint16_t record,
+                                  uint16_t record_count, RegisterWords words) {
+        return false;
+    }
+    bool execute_write_file_record(uint16_t file, uint16_t record,
+                                   uint16_t record_count,
+                                   ConstRegisterWords words) {
+        return false;
+    }
     bool execute_write_single_coil(uint16_t address, bool vparam) {
         return false;
     }
+    bool execute_read_single_register(uint16_t address, uint16_t *w) {
+        return false;
+    }
     bool execute_write_single_register(uint16_t address, uint16_t v) {
         return false;
     }
@@ -103,6 +208,20 @@ template <class PduHandler> class PduHandlerBase {
                                           uint16_t bit_count) {
         return true;
     }
+    bool is_read_discrete_inputs_supported() {
+        return false;
+    }
+    bool is_read_discrete_inputs_valid_data_address(uint16_t address,
+                                                    uint16_t bit_count) {
+        return true;
+    }
+    bool is_read_input_registers_supported() {
+        return false;
+    }
+    bool is_read_input_registers_valid_data_address(uint16_t address,
+                                                    uint16_t register_count) {
+        return true;
+    }
     bool is_read_registers_supported() {
         return false;
     }
@@ -133,14 +252,74 @@ template <class PduHandler> class PduHandlerBase {
     bool is_write_single_register_supported() {
         return self().is_write_registers_supported();
     }
+    bool is_read_write_registers_supported() {
+        return self().is_read_registers_supported() &&
+               self().is_write_registers_supported();
+    }
+    bool is_mask_write_register_supported() {
+        return self().is_read_write_registers_supported();
+    }
+    bool is_diagnostics_supported() {
+        return stats != nullptr;
+    }
+    bool is_read_file_record_supported() {
+        return false;
+    }
+    bool is_write_file_record_supported() {
+        return false;
+    }
+    bool is_read_file_record_valid_data_address(uint16_t file,
+                                                uint16_t record,
+                                                uint16_t record_count) {
+        return true;
+    }
+    bool is_write_file_record_valid_data_address(uint16_t file,
+                                                 uint16_t record,
+                                                 uint16_t record_count) {
+        return true;
+    }
+    // the objects of Read Device Identification, usually
+    // &DeviceIdentification<objects>::table.
+    const DeviceIdentificationTable *device_identification() {
+        return nullptr;
+    }
+    bool is_read_device_identification_supported() {
+        return self().device_identification() != nullptr;
+    }
 
   private:
-    static constexpr int WRITE_COILS_REPLY_LENGTH      = 6;
-    static constexpr int WRITE_REGISTERS_REPLY_LENGTH  = 6;
-    static constexpr int READ_WRITE_COILS_MAX_COILS    = 0x07b0;
-    static constexpr int WRITE_REGISTERS_MAX_REGISTERS = 0x07b;
-    static constexpr int READ_REGISTERS_MAX_REGISTERS  = 0x007d;
+    static constexpr bool is_compiled_in(RtuFunctionCode function) {
+        return SupportedFunctions<PduHandler>::value.contains(function);
+    }
+    static constexpr int WRITE_COILS_REPLY_LENGTH         = 6;
+    static constexpr int WRITE_REGISTERS_REPLY_LENGTH     = 6;
+    static constexpr int READ_WRITE_COILS_MAX_COILS       = 0x07b0;
+    static constexpr int WRITE_REGISTERS_MAX_REGISTERS    = 0x07b;
+    static constexpr int READ_REGISTERS_MAX_REGISTERS     = 0x007d;
+    static constexpr int READ_WRITE_REGISTERS_MAX_WRITE   = 0x0079;
+    static constexpr int DIAGNOSTIC_REPLY_LENGTH          = 6;
+    static constexpr int COM_EVENT_COUNTER_REPLY_LENGTH   = 6;
+    static constexpr int MASK_WRITE_REGISTER_REPLY_LENGTH = 8;
+    static constexpr int FILE_REFERENCE_TYPE              = 6;
+    static constexpr int FILE_SUB_REQUEST_LENGTH          = 7;
+    static constexpr int FILE_REQUEST_MAX_LENGTH          = 0xf5;
+    static constexpr int FILE_WRITE_MIN_LENGTH            = 0x09;
+    static constexpr int FILE_WRITE_MAX_LENGTH            = 0xfb;
+    static constexpr int FILE_MAX_RECORD                  = 0x270f;
+    static constexpr int MEI_READ_DEVICE_IDENTIFICATION   = 0x0e;
+    static constexpr int DEVICE_ID_BASIC                  = 0x01;
+    static constexpr int DEVICE_ID_REGULAR                = 0x02;
+    static constexpr int DEVICE_ID_INDIVIDUAL             = 0x04;
+    static constexpr int DEVICE_ID_HEADER_LENGTH          = 8;
+    static constexpr int DEVICE_ID_OBJECTS_MAX_LENGTH =
+        PDU_MAX - 2 - DEVICE_ID_HEADER_LENGTH;
     RtuAddress address;
+    ModbusStats *stats = nullptr;
+    struct FileSubRequest {
+        uint16_t file;
+        uint16_t record;
+        uint16_t record_count;
+    };
     void append_crc(RtuMessage &reply) {
         auto crc = vla_modbus_crc16(reply.buffer, reply.length);
         reply.buffer[reply.length]     = crc;
@@ -171,38 +350,139 @@ template <class PduHandler> class PduHandlerBase {
                register_count <= WRITE_REGISTERS_MAX_REGISTERS &&
                byte_count == register_count * 2;
     }
+    bool is_read_write_registers_valid_data_value(uint16_t read_count,
+                                                  uint16_t write_count,
+                                                  uint8_t byte_count) {
+        return is_read_registers_valid_data_value(read_count) &&
+               write_count > 0 &&
+               write_count <= READ_WRITE_REGISTERS_MAX_WRITE &&
+               byte_count == write_count * 2;
+    }
+    // p points to the reference type of the sub-request
+    static FileSubRequest parse_file_sub_request(const uint8_t *p) {
+        return {read_big_endian(&p[1]), read_big_endian(&p[3]),
+                read_big_endian(&p[5])};
+    }
+    bool is_file_record_valid_data_address(uint8_t reference_type,
+                                           const FileSubRequest &sub) {
+        return reference_type == FILE_REFERENCE_TYPE && sub.file != 0 &&
+               uint32_t(sub.record) + sub.record_count <= FILE_MAX_RECORD + 1;
+    }
     bool is_write_single_coil_valid_data_value(uint16_t v) {
         return 0x0000 == v || 0xff00 == v;
     }
+    // only the functions in SUPPORTED_FUNCTIONS are compiled in, the
+    // others are answered with ILLEGAL_FUNCTION.
     void execute_function(const RtuMessage &indication, RtuMessage &reply) {
         switch (indication.function_code()) {
         case RtuFunctionCode::READ_COILS:
-            execute_read_coils(indication, reply);
+            if constexpr (is_compiled_in(RtuFunctionCode::READ_COILS)) {
+                execute_read_coils(indication, reply);
+                return;
+            }
+            break;
+        case RtuFunctionCode::READ_DISCRETE_INPUT:
+            if constexpr (is_compiled_in(
+                              RtuFunctionCode::READ_DISCRETE_INPUT)) {
+                execute_read_discrete_inputs(indication, reply);
+                return;
+            }
             break;
         case RtuFunctionCode::WRITE_SINGLE_COIL:
-            execute_write_single_coil(indication, reply);
+            if constexpr (is_compiled_in(RtuFunctionCode::WRITE_SINGLE_COIL)) {
+                execute_write_single_coil(indication, reply);
+                return;
+            }
             break;
         case RtuFunctionCode::WRITE_COILS:
-            execute_write_coils(indication, reply);
+            if constexpr (is_compiled_in(RtuFunctionCode::WRITE_COILS)) {
+                execute_write_coils(indication, reply);
+                return;
+            }
             break;
         case RtuFunctionCode::READ_HOLDING_REGISTERS:
-            execute_read_registers(indication, reply);
+            if constexpr (is_compiled_in(
+                              RtuFunctionCode::READ_HOLDING_REGISTERS)) {
+                execute_read_registers(indication, reply);
+                return;
+            }
+            break;
+        case RtuFunctionCode::READ_INPUT_REGISTER:
+            if constexpr (is_compiled_in(
+                              RtuFunctionCode::READ_INPUT_REGISTER)) {
+                execute_read_input_registers(indication, reply);
+                return;
+            }
             break;
         case RtuFunctionCode::WRITE_MULTIPLE_REGISTERS:
-            execute_write_registers(indication, reply);
+            if constexpr (is_compiled_in(
+                              RtuFunctionCode::WRITE_MULTIPLE_REGISTERS)) {
+                execute_write_registers(indication, reply);
+                return;
+            }
             break;
         case RtuFunctionCode::WRITE_SINGLE_REGISTER:
-            execute_write_single_register(indication, reply);
+            if constexpr (is_compiled_in(
+                              RtuFunctionCode::WRITE_SINGLE_REGISTER)) {
+                execute_write_single_register(indication, reply);
+                return;
+            }
+            break;
+        case RtuFunctionCode::READ_WRITE_MULTIPLE_REGISTERS:
+            if constexpr (is_compiled_in(
+                              RtuFunctionCode::READ_WRITE_MULTIPLE_REGISTERS)) {
+                execute_read_write_registers(indication, reply);
+                return;
+            }
+            break;
+        case RtuFunctionCode::MASK_WRITE_REGISTER:
+            if constexpr (is_compiled_in(
+                              RtuFunctionCode::MASK_WRITE_REGISTER)) {
+                execute_mask_write_register(indication, reply);
+                return;
+            }
+            break;
+        case RtuFunctionCode::DIAGNOSTIC:
+            if constexpr (is_compiled_in(RtuFunctionCode::DIAGNOSTIC)) {
+                execute_diagnostic(indication, reply);
+                return;
+            }
+            break;
+        case RtuFunctionCode::GET_COM_EVENT_COUNTER:
+            if constexpr (is_compiled_in(
+                              RtuFunctionCode::GET_COM_EVENT_COUNTER)) {
+                execute_get_com_event_counter(indication, reply);
+                return;
+            }
+            break;
+        case RtuFunctionCode::READ_FILE_RECORD:
+            if constexpr (is_compiled_in(RtuFunctionCode::READ_FILE_RECORD)) {
+                execute_read_file_record(indication, reply);
+                return;
+            }
+            break;
+        case RtuFunctionCode::WRITE_FILE_RECORD:
+            if constexpr (is_compiled_in(RtuFunctionCode::WRITE_FILE_RECORD)) {
+                execute_write_file_record(indication, reply);
+                return;
+            }
+            break;
+        case RtuFunctionCode::READ_DEVICE_IDENTIFICATION:
+            if constexpr (is_compiled_in(
+                              RtuFunctionCode::READ_DEVICE_IDENTIFICATION)) {
+                execute_read_device_identification(indication, reply);
+                return;
+            }
             break;
         default:
-            make_exception_reply(RtuExceptionCode::ILLEGAL_FUNCTION, indication,
-                                 reply);
-            return;
+            break;
         }
+        make_exception_reply(RtuExceptionCode::ILLEGAL_FUNCTION, indication,
+                             reply);
     }
     void execute_read_coils(const RtuMessage &indication, RtuMessage &reply) {
-        uint16_t address   = fix_endianess(*(uint16_t *)&indication.buffer[2]),
-                 bit_count = fix_endianess(*(uint16_t *)&indication.buffer[4]);
+        uint16_t address   = read_big_endian(&indication.buffer[2]),
+                 bit_count = read_big_endian(&indication.buffer[4]);
         if (!self().is_read_coils_supported()) {
             make_exception_reply(RtuExceptionCode::ILLEGAL_FUNCTION, indication,
                                  reply);
@@ -229,11 +509,41 @@ template <class PduHandler> class PduHandlerBase {
         reply.buffer[1] = indication.buffer[1];
         reply.length    = reply.buffer[2] + 3;
     }
+    void execute_read_discrete_inputs(const RtuMessage &indication,
+                                      RtuMessage &reply) {
+        uint16_t address   = read_big_endian(&indication.buffer[2]),
+                 bit_count = read_big_endian(&indication.buffer[4]);
+        if (!self().is_read_discrete_inputs_supported()) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_FUNCTION, indication,
+                                 reply);
+            return;
+        }
+        if (!self().is_read_discrete_inputs_valid_data_address(address,
+                                                               bit_count)) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_DATA_ADDRESS,
+                                 indication, reply);
+            return;
+        }
+        if (!self().is_read_coils_valid_data_value(bit_count)) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_DATA_VALUE,
+                                 indication, reply);
+            return;
+        }
+        if (!self().execute_read_discrete_inputs(address, bit_count,
+                                                 &reply.buffer[3])) {
+            make_exception_reply(RtuExceptionCode::SERVER_DEVICE_FAILURE,
+                                 indication, reply);
+            return;
+        }
+        reply.buffer[2] = bit_count / 8 + uint8_t(bool(bit_count % 8));
+        reply.buffer[0] = indication.buffer[0];
+        reply.buffer[1] = indication.buffer[1];
+        reply.length    = reply.buffer[2] + 3;
+    }
     void execute_read_registers(const RtuMessage &indication,
                                 RtuMessage &reply) {
-        uint16_t address = fix_endianess(*(uint16_t *)&indication.buffer[2]),
-                 register_count =
-                     fix_endianess(*(uint16_t *)&indication.buffer[4]);
+        uint16_t address        = read_big_endian(&indication.buffer[2]),
+                 register_count = read_big_endian(&indication.buffer[4]);
         if (!self().is_read_registers_supported()) {
             make_exception_reply(RtuExceptionCode::ILLEGAL_FUNCTION, indication,
                                  reply);
@@ -250,13 +560,8 @@ template <class PduHandler> class PduHandlerBase {
                                  indication, reply);
             return;
         }
-        uint16_t words[PDU_MAX];
-        std::memcpy(words, &reply.buffer[3], register_count * 2);
-        if (self().execute_read_registers(address, register_count, words)) {
-            for (uint16_t i = 0; i < register_count; ++i) {
-                words[i] = fix_endianess(words[i]);
-            }
-            std::memcpy(&reply.buffer[3], words, register_count * 2);
+        if (self().execute_read_registers(address, register_count,
+                                          RegisterWords(&reply.buffer[3]))) {
             reply.buffer[0] = indication.buffer[0];
             reply.buffer[1] = indication.buffer[1];
             reply.buffer[2] = register_count * 2;
@@ -266,9 +571,40 @@ template <class PduHandler> class PduHandlerBase {
                                  indication, reply);
         }
     }
+    void execute_read_input_registers(const RtuMessage &indication,
+                                      RtuMessage &reply) {
+        uint16_t address        = read_big_endian(&indication.buffer[2]),
+                 register_count = read_big_endian(&indication.buffer[4]);
+        if (!self().is_read_input_registers_supported()) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_FUNCTION, indication,
+                                 reply);
+            return;
+        }
+        if (!self().is_read_input_registers_valid_data_address(
+                address, register_count)) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_DATA_ADDRESS,
+                                 indication, reply);
+            return;
+        }
+        if (!self().is_read_registers_valid_data_value(register_count)) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_DATA_VALUE,
+                                 indication, reply);
+            return;
+        }
+        if (!self().execute_read_input_registers(
+                address, register_count, RegisterWords(&reply.buffer[3]))) {
+            make_exception_reply(RtuExceptionCode::SERVER_DEVICE_FAILURE,
+                                 indication, reply);
+            return;
+        }
+        reply.buffer[0] = indication.buffer[0];
+        reply.buffer[1] = indication.buffer[1];
+        reply.buffer[2] = register_count * 2;
+        reply.length    = register_count * 2 + 3;
+    }
     void execute_write_coils(const RtuMessage &indication, RtuMessage &reply) {
-        uint16_t address    = fix_endianess(*(uint16_t *)&indication.buffer[2]),
-                 bit_count  = fix_endianess(*(uint16_t *)&indication.buffer[4]),
+        uint16_t address    = read_big_endian(&indication.buffer[2]),
+                 bit_count  = read_big_endian(&indication.buffer[4]),
                  byte_count = indication.buffer[6];
         uint8_t *bits       = &indication.buffer[7];
         if (!self().is_write_coils_supported()) {
@@ -295,12 +631,9 @@ template <class PduHandler> class PduHandlerBase {
     }
     void execute_write_registers(const RtuMessage &indication,
                                  RtuMessage &reply) {
-        uint16_t address = fix_endianess(*(uint16_t *)&indication.buffer[2]),
-                 register_count =
-                     fix_endianess(*(uint16_t *)&indication.buffer[4]);
-        uint8_t byte_count = indication.buffer[6];
-        uint16_t words[PDU_MAX];
-        std::memcpy(words, &indication.buffer[7], byte_count);
+        uint16_t address        = read_big_endian(&indication.buffer[2]),
+                 register_count = read_big_endian(&indication.buffer[4]);
+        uint8_t byte_count      = indication.buffer[6];
         if (!self().is_write_registers_supported()) {
             make_exception_reply(RtuExceptionCode::ILLEGAL_FUNCTION, indication,
                                  reply);
@@ -318,10 +651,9 @@ template <class PduHandler> class PduHandlerBase {
                                  indication, reply);
             return;
         }
-        for (uint16_t i = 0; i < register_count; ++i) {
-            words[i] = fix_endianess(words[i]);
-        }
-        if (!self().execute_write_registers(address, words, register_count)) {
+        if (!self().execute_write_registers(
+                address, ConstRegisterWords(&indication.buffer[7]),
+                register_count)) {
             make_exception_reply(RtuExceptionCode::SERVER_DEVICE_FAILURE,
                                  indication, reply);
             return;
@@ -330,8 +662,8 @@ template <class PduHandler> class PduHandlerBase {
     }
     void execute_write_single_coil(const RtuMessage &indication,
                                    RtuMessage &reply) {
-        uint16_t address = fix_endianess(*(uint16_t *)&indication.buffer[2]),
-                 value   = fix_endianess(*(uint16_t *)&indication.buffer[4]);
+        uint16_t address = read_big_endian(&indication.buffer[2]),
+                 value   = read_big_endian(&indication.buffer[4]);
         if (!self().is_write_single_coil_supported()) {
             make_exception_reply(RtuExceptionCode::ILLEGAL_FUNCTION, indication,
                                  reply);
@@ -358,9 +690,7 @@ template <class PduHandler> class PduHandlerBase {
     }
     void execute_write_single_register(const RtuMessage &indication,
                                        RtuMessage &reply) {
-        uint16_t address = fix_endianess(*(uint16_t *)&indication.buffer[2]),
-                 register_value =
-                     fix_endianess(*(uint16_t *)&indication.buffer[4]);
+        uint16_t address = read_big_endian(&indication.buffer[2]);
         if (!self().is_write_single_register_supported()) {
             make_exception_reply(RtuExceptionCode::ILLEGAL_FUNCTION, indication,
                                  reply);
@@ -371,13 +701,335 @@ template <class PduHandler> class PduHandlerBase {
                                  indication, reply);
             return;
         }
-        if (!self().execute_write_registers(address, &register_value, 1)) {
+        if (!self().execute_write_registers(
+                address, ConstRegisterWords(&indication.buffer[4]), 1)) {
             make_exception_reply(RtuExceptionCode::SERVER_DEVICE_FAILURE,
                                  indication, reply);
             return;
         }
         make_echo_reply_no_crc(indication, reply);
     }
+    // the write is done before the read, as the specification requires.
+    // Reply and indication may share their buffer: the read data only
+    // overwrites the write data once it has been consumed.
+    void execute_read_write_registers(const RtuMessage &indication,
+                                      RtuMessage &reply) {
+        uint16_t read_address  = read_big_endian(&indication.buffer[2]),
+                 read_count    = read_big_endian(&indication.buffer[4]),
+                 write_address = read_big_endian(&indication.buffer[6]),
+                 write_count   = read_big_endian(&indication.buffer[8]);
+        uint8_t byte_count     = indication.buffer[10];
+        if (!self().is_read_write_registers_supported()) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_FUNCTION, indication,
+                                 reply);
+            return;
+        }
+        if (!self().is_write_registers_valid_data_address(write_address,
+                                                          write_count) ||
+            !self().is_read_registers_valid_data_address(read_address,
+                                                         read_count)) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_DATA_ADDRESS,
+                                 indication, reply);
+            return;
+        }
+        if (!self().is_read_write_registers_valid_data_value(
+                read_count, write_count, byte_count)) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_DATA_VALUE,
+                                 indication, reply);
+            return;
+        }
+        if (!self().execute_write_registers(
+                write_address, ConstRegisterWords(&indication.buffer[11]),
+                write_count) ||
+            !self().execute_read_registers(read_address, read_count,
+                                           RegisterWords(&reply.buffer[3]))) {
+            make_exception_reply(RtuExceptionCode::SERVER_DEVICE_FAILURE,
+                                 indication, reply);
+            return;
+        }
+        reply.buffer[0] = indication.buffer[0];
+        reply.buffer[1] = indication.buffer[1];
+        reply.buffer[2] = read_count * 2;
+        reply.length    = read_count * 2 + 3;
+    }
+    void execute_mask_write_register(const RtuMessage &indication,
+                                     RtuMessage &reply) {
+        uint16_t address  = read_big_endian(&indication.buffer[2]),
+                 and_mask = read_big_endian(&indication.buffer[4]),
+                 or_mask  = read_big_endian(&indication.buffer[6]);
+        if (!self().is_mask_write_register_supported()) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_FUNCTION, indication,
+                                 reply);
+            return;
+        }
+        if (!self().is_read_registers_valid_data_address(address, 1) ||
+            !self().is_write_registers_valid_data_address(address, 1)) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_DATA_ADDRESS,
+                                 indication, reply);
+            return;
+        }
+        if (!self().execute_mask_write_register(address, and_mask, or_mask)) {
+            make_exception_reply(RtuExceptionCode::SERVER_DEVICE_FAILURE,
+                                 indication, reply);
+            return;
+        }
+        make_echo_reply(indication, reply, MASK_WRITE_REGISTER_REPLY_LENGTH);
+    }
+    // every sub-request is checked before any is served. Reply and
+    // indication may share their buffer and the replies grow faster
+    // than the sub-requests, so these are parsed first.
+    void execute_read_file_record(const RtuMessage &indication,
+                                  RtuMessage &reply) {
+        uint8_t byte_count = indication.buffer[2];
+        if (!self().is_read_file_record_supported()) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_FUNCTION, indication,
+                                 reply);
+            return;
+        }
+        if (byte_count < FILE_SUB_REQUEST_LENGTH ||
+            byte_count > FILE_REQUEST_MAX_LENGTH ||
+            byte_count % FILE_SUB_REQUEST_LENGTH ||
+            byte_count + 5 > indication.length) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_DATA_VALUE,
+                                 indication, reply);
+            return;
+        }
+        FileSubRequest subs[FILE_REQUEST_MAX_LENGTH / FILE_SUB_REQUEST_LENGTH];
+        uint16_t sub_count    = byte_count / FILE_SUB_REQUEST_LENGTH;
+        uint32_t reply_length = 0;
+        for (uint16_t i = 0; i < sub_count; ++i) {
+            auto p  = &indication.buffer[3 + i * FILE_SUB_REQUEST_LENGTH];
+            subs[i] = parse_file_sub_request(p);
+            if (!subs[i].record_count) {
+                make_exception_reply(RtuExceptionCode::ILLEGAL_DATA_VALUE,
+                                     indication, reply);
+                return;
+            }
+            if (!is_file_record_valid_data_address(p[0], subs[i]) ||
+                !self().is_read_file_record_valid_data_address(
+                    subs[i].file, subs[i].record, subs[i].record_count)) {
+                make_exception_reply(RtuExceptionCode::ILLEGAL_DATA_ADDRESS,
+                                     indication, reply);
+                return;
+            }
+            reply_length += 2 + 2 * subs[i].record_count;
+        }
+        if (reply_length > FILE_REQUEST_MAX_LENGTH) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_DATA_VALUE,
+                                 indication, reply);
+            return;
+        }
+        auto out = &reply.buffer[3];
+        for (uint16_t i = 0; i < sub_count; ++i) {
+            out[0] = 1 + 2 * subs[i].record_count;
+            out[1] = FILE_REFERENCE_TYPE;
+            if (!self().execute_read_file_record(
+                    subs[i].file, subs[i].record, subs[i].record_count,
+                    RegisterWords(&out[2]))) {
+                make_exception_reply(RtuExceptionCode::SERVER_DEVICE_FAILURE,
+                                     indication, reply);
+                return;
+            }
+            out += 2 + 2 * subs[i].record_count;
+        }
+        reply.buffer[0] = indication.buffer[0];
+        reply.buffer[1] = indication.buffer[1];
+        reply.buffer[2] = reply_length;
+        reply.length    = reply_length + 3;
+    }
+    // the reply echoes the request, so the records are written from
+    // the indication in place.
+    void execute_write_file_record(const RtuMessage &indication,
+                                   RtuMessage &reply) {
+        uint8_t data_length = indication.buffer[2];
+        if (!self().is_write_file_record_supported()) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_FUNCTION, indication,
+                                 reply);
+            return;
+        }
+        if (data_length < FILE_WRITE_MIN_LENGTH ||
+            data_length > FILE_WRITE_MAX_LENGTH ||
+            data_length + 5 > indication.length) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_DATA_VALUE,
+                                 indication, reply);
+            return;
+        }
+        const uint8_t *end = &indication.buffer[3 + data_length];
+        for (auto p = &indication.buffer[3]; p < end;) {
+            if (end - p < FILE_SUB_REQUEST_LENGTH) {
+                make_exception_reply(RtuExceptionCode::ILLEGAL_DATA_VALUE,
+                                     indication, reply);
+                return;
+            }
+            auto sub = parse_file_sub_request(p);
+            if (!sub.record_count ||
+                end - p < FILE_SUB_REQUEST_LENGTH + 2 * sub.record_count) {
+                make_exception_reply(RtuExceptionCode::ILLEGAL_DATA_VALUE,
+                                     indication, reply);
+                return;
+            }
+            if (!is_file_record_valid_data_address(p[0], sub) ||
+                !self().is_write_file_record_valid_data_address(
+                    sub.file, sub.record, sub.record_count)) {
+                make_exception_reply(RtuExceptionCode::ILLEGAL_DATA_ADDRESS,
+                                     indication, reply);
+                return;
+            }
+            p += FILE_SUB_REQUEST_LENGTH + 2 * sub.record_count;
+        }
+        for (auto p = &indication.buffer[3]; p < end;) {
+            auto sub = parse_file_sub_request(p);
+            if (!self().execute_write_file_record(
+                    sub.file, sub.record, sub.record_count,
+                    ConstRegisterWords(&p[FILE_SUB_REQUEST_LENGTH]))) {
+                make_exception_reply(RtuExceptionCode::SERVER_DEVICE_FAILURE,
+                                     indication, reply);
+                return;
+            }
+            p += FILE_SUB_REQUEST_LENGTH + 2 * sub.record_count;
+        }
+        make_echo_reply(indication, reply, data_length + 3);
+    }
+    // stream access (codes 1 to 3) returns the objects of the category
+    // from object id on, or from the first one if there is no such
+    // object in it, as many as fit. The master asks for the rest with
+    // the next object id of the reply. The objects are copied as they
+    // are from the table.
+    void execute_read_device_identification(const RtuMessage &indication,
+                                            RtuMessage &reply) {
+        uint8_t mei_type = indication.buffer[2], code = indication.buffer[3],
+                object_id = indication.buffer[4];
+        if (mei_type != MEI_READ_DEVICE_IDENTIFICATION ||
+            !self().is_read_device_identification_supported()) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_FUNCTION, indication,
+                                 reply);
+            return;
+        }
+        if (code < DEVICE_ID_BASIC || code > DEVICE_ID_INDIVIDUAL) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_DATA_VALUE,
+                                 indication, reply);
+            return;
+        }
+        auto table    = self().device_identification();
+        uint8_t first = table->find(object_id), end, more = 0, next = 0;
+        if (code == DEVICE_ID_INDIVIDUAL) {
+            if (first == table->count) {
+                make_exception_reply(RtuExceptionCode::ILLEGAL_DATA_ADDRESS,
+                                     indication, reply);
+                return;
+            }
+            end = first + 1;
+        } else {
+            uint8_t last_id = code == DEVICE_ID_BASIC     ? 0x02
+                              : code == DEVICE_ID_REGULAR ? 0x7f
+                                                          : 0xff;
+            if (first == table->count || table->id(first) > last_id) {
+                first = 0;
+            }
+            for (end = first; end < table->count && table->id(end) <= last_id;
+                 ++end) {
+                if (table->offsets[end + 1] - table->offsets[first] >
+                    DEVICE_ID_OBJECTS_MAX_LENGTH) {
+                    more = 0xff;
+                    next = table->id(end);
+                    break;
+                }
+            }
+        }
+        uint16_t length = table->offsets[end] - table->offsets[first];
+        memcpy(&reply.buffer[DEVICE_ID_HEADER_LENGTH],
+               &table->objects[table->offsets[first]], length);
+        reply.buffer[0] = indication.buffer[0];
+        reply.buffer[1] = indication.buffer[1];
+        reply.buffer[2] = mei_type;
+        reply.buffer[3] = code;
+        reply.buffer[4] = table->conformity_level;
+        reply.buffer[5] = more;
+        reply.buffer[6] = next;
+        reply.buffer[7] = end - first;
+        reply.length    = DEVICE_ID_HEADER_LENGTH + length;
+    }
+    // the counter sub-functions report the 16 low bits of the counters.
+    void execute_diagnostic(const RtuMessage &indication, RtuMessage &reply) {
+        uint16_t sub_function = read_big_endian(&indication.buffer[2]),
+                 data         = read_big_endian(&indication.buffer[4]);
+        if (!self().is_diagnostics_supported()) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_FUNCTION, indication,
+                                 reply);
+            return;
+        }
+        uint32_t value;
+        switch (RtuDiagnosticCode(sub_function)) {
+        case RtuDiagnosticCode::RETURN_QUERY_DATA:
+            make_echo_reply_no_crc(indication, reply);
+            return;
+        case RtuDiagnosticCode::RESTART_COMMUNICATIONS_OPTION:
+            if (data != 0x0000 && data != 0xff00) {
+                make_exception_reply(RtuExceptionCode::ILLEGAL_DATA_VALUE,
+                                     indication, reply);
+                return;
+            }
+            stats->clear();
+            make_echo_reply_no_crc(indication, reply);
+            return;
+        case RtuDiagnosticCode::CLEAR_COUNTERS:
+            stats->clear();
+            make_echo_reply_no_crc(indication, reply);
+            return;
+        case RtuDiagnosticCode::RETURN_BUS_MESSAGE_COUNT:
+            value = stats->frames_received + stats->framing_errors;
+            break;
+        case RtuDiagnosticCode::RETURN_BUS_COMMUNICATION_ERROR:
+            value = stats->crc_errors;
+            break;
+        case RtuDiagnosticCode::RETURN_BUS_EXCEPTION_ERROR_COUNT:
+            value = stats->exceptions_sent();
+            break;
+        case RtuDiagnosticCode::RETURN_SERVER_MESSAGE_COUNT:
+            value = stats->replies + stats->broadcasts;
+            break;
+        case RtuDiagnosticCode::RETURN_SERVER_NO_RESPONSE_COUNT:
+            value = stats->broadcasts;
+            break;
+        case RtuDiagnosticCode::RETURN_SERVER_NAK_COUNT:
+            value = stats->exceptions[int(
+                RtuExceptionCode::NEGATIVE_ACKNOWLEDGE)];
+            break;
+        case RtuDiagnosticCode::RETURN_SERVER_BUSY_COUNT:
+            value =
+                stats->exceptions[int(RtuExceptionCode::SERVER_DEVICE_BUSY)];
+            break;
+        case RtuDiagnosticCode::RETURN_BUS_CHARACTER_OVERRUN_COUNT:
+            // chars, or whole frames in RxMode::FRAMES, that came in
+            // faster than the daemon could take them
+            value = stats->queue_overflows;
+            break;
+        default:
+            make_exception_reply(RtuExceptionCode::ILLEGAL_FUNCTION, indication,
+                                 reply);
+            return;
+        }
+        make_echo_reply(indication, reply, DIAGNOSTIC_REPLY_LENGTH);
+        reply.buffer[4] = value >> 8;
+        reply.buffer[5] = value;
+    }
+    void execute_get_com_event_counter(const RtuMessage &indication,
+                                       RtuMessage &reply) {
+        if (!self().is_diagnostics_supported()) {
+            make_exception_reply(RtuExceptionCode::ILLEGAL_FUNCTION, indication,
+                                 reply);
+            return;
+        }
+        uint32_t events = stats->comm_events;
+        reply.buffer[0] = indication.buffer[0];
+        reply.buffer[1] = indication.buffer[1];
+        // status word, never busy
+        reply.buffer[2] = 0;
+        reply.buffer[3] = 0;
+        reply.buffer[4] = events >> 8;
+        reply.buffer[5] = events;
+        reply.length    = COM_EVENT_COUNTER_REPLY_LENGTH;
+    }
     void make_echo_reply_no_crc(const RtuMessage &indication,
                                 RtuMessage &reply) {
         memmove(reply.buffer, indication.buffer, indication.length - 2);
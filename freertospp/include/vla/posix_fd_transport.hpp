@@ -0,0 +1,31 @@
+#ifndef VLA_POSIX_FD_TRANSPORT_HPP
+#define VLA_POSIX_FD_TRANSPORT_HPP
+
+#include <vla/modbus_daemon.hpp>
+
+namespace vla {
+
+/**
+ * Transport over a POSIX file descriptor such as a pty or one end of a
+ * socketpair. It is meant for host builds on top of the FreeRTOS POSIX
+ * port, where it lets the whole daemon run and be benchmarked without
+ * hardware. The descriptor is switched to non blocking mode and polled.
+ */
+class PosixFdTransport {
+  public:
+    explicit PosixFdTransport(int fd);
+    PosixFdTransport(const PosixFdTransport &) = delete;
+    PosixFdTransport &operator=(const PosixFdTransport &) = delete;
+
+    void start(RxSink &sink);
+    void write(const uint8_t *data, uint16_t length, ModbusDaemonQueue &q);
+
+  private:
+    int fd;
+    RxSink *sink = nullptr;
+    static void drain(RxSink &sink, void *data, BaseType_t *taskWoken);
+};
+
+} // namespace vla
+
+#endif // VLA_POSIX_FD_TRANSPORT_HPP
@@ -115,8 +115,8 @@ template <typename ItemType> class Queue {
         return pdTRUE == xQueueReceive(queue.get(), &v, wait);
     }
 
-    bool receiveFromIsr(ItemType &v, TickType_t wait = portMAX_DELAY) {
-        return pdTRUE == xQueueReceiveFromISR(queue.get(), &v, wait);
+    bool receiveFromIsr(ItemType &v, BaseType_t *taskWoken = nullptr) {
+        return pdTRUE == xQueueReceiveFromISR(queue.get(), &v, taskWoken);
     }
 
     ItemType receive(TickType_t wait = portMAX_DELAY) {
@@ -129,8 +129,8 @@ template <typename ItemType> class Queue {
         return pdTRUE == xQueuePeek(queue.get(), &v, wait);
     }
 
-    bool peekFromIsr(ItemType &v, TickType_t wait = portMAX_DELAY) {
-        return pdTRUE == xQueuePeekFromISR(queue.get(), &v, wait);
+    bool peekFromIsr(ItemType &v) {
+        return pdTRUE == xQueuePeekFromISR(queue.get(), &v);
     }
 
     ItemType peek(TickType_t wait = portMAX_DELAY) {
@@ -139,6 +139,10 @@ template <typename ItemType> class Queue {
         return v;
     }
 
+    UBaseType_t messages_waiting() const {
+        return uxQueueMessagesWaiting(queue.get());
+    }
+
     operator bool() const {
         return queue;
     }
@@ -0,0 +1,221 @@
+#ifndef VLA_REGISTER_MAP_HPP
+#define VLA_REGISTER_MAP_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vla/big_endian.hpp>
+
+namespace vla {
+
+/**
+ * A block of consecutive registers and where its values live: a plain
+ * array, an array of atomics for values shared with other tasks or
+ * interrupts, or a pair of callbacks for computed values. Build them
+ * with array_registers, atomic_registers and callback_registers.
+ */
+struct RegisterRange {
+    enum class Kind : uint8_t { ARRAY, ATOMIC, CALLBACK };
+    // the callbacks get the register address, not its offset in the range
+    using ReadCallback  = bool (*)(uint16_t address, uint16_t *value);
+    using WriteCallback = bool (*)(uint16_t address, uint16_t value);
+
+    uint16_t address;
+    uint16_t count;
+    Kind kind;
+    bool writable;
+    uint16_t *array;
+    std::atomic<uint16_t> *atomics;
+    ReadCallback read;
+    WriteCallback write;
+
+    constexpr uint32_t end() const {
+        return uint32_t(address) + count;
+    }
+};
+
+template <size_t N>
+constexpr RegisterRange array_registers(uint16_t address,
+                                        uint16_t (&array)[N]) {
+    return {address, uint16_t(N), RegisterRange::Kind::ARRAY, true, array,
+            nullptr, nullptr,     nullptr};
+}
+
+// read only
+template <size_t N>
+constexpr RegisterRange array_registers(uint16_t address,
+                                        const uint16_t (&array)[N]) {
+    return {address, uint16_t(N), RegisterRange::Kind::ARRAY, false,
+            const_cast<uint16_t *>(array), nullptr, nullptr, nullptr};
+}
+
+template <size_t N>
+constexpr RegisterRange atomic_registers(uint16_t address,
+                                         std::atomic<uint16_t> (&atomics)[N],
+                                         bool writable = true) {
+    return {address, uint16_t(N), RegisterRange::Kind::ATOMIC, writable,
+            nullptr, atomics,     nullptr,                     nullptr};
+}
+
+// read only if write is null
+constexpr RegisterRange
+callback_registers(uint16_t address, uint16_t count,
+                   RegisterRange::ReadCallback read,
+                   RegisterRange::WriteCallback write = nullptr) {
+    return {address, count,   RegisterRange::Kind::CALLBACK, write != nullptr,
+            nullptr, nullptr, read,                          write};
+}
+
+template <size_t N>
+constexpr bool are_sorted_and_disjoint(const RegisterRange (&ranges)[N]) {
+    for (size_t i = 0; i < N; ++i) {
+        if (ranges[i].count == 0 || ranges[i].end() > 0x10000) {
+            return false;
+        }
+        if (i > 0 && ranges[i].address < ranges[i - 1].end()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Register map checked and laid out at compile time. The ranges must
+ * be a constexpr array with static storage, sorted by address:
+ *
+ * static uint16_t setpoints[8];
+ * static std::atomic<uint16_t> status[2];
+ * static constexpr vla::RegisterRange holding_ranges[] = {
+ *     vla::array_registers(0, setpoints),
+ *     vla::atomic_registers(0x100, status, false),
+ *     vla::callback_registers(0x200, 1, read_uptime),
+ * };
+ * using HoldingRegisters = vla::RegisterMap<holding_ranges>;
+ *
+ * Overlapping ranges fail to compile. A request may span adjacent
+ * ranges but not the gaps between them. read and write work on the
+ * registers in place in the PDU, so array ranges are copied and byte
+ * swapped in one pass straight into the reply:
+ *
+ * bool execute_read_registers(uint16_t address, uint16_t register_count,
+ *                             vla::RegisterWords words) {
+ *     return HoldingRegisters::read(address, register_count, words);
+ * }
+ */
+template <const auto &Ranges> class RegisterMap {
+    static_assert(are_sorted_and_disjoint(Ranges),
+                  "register ranges must be sorted by address, not empty "
+                  "and must not overlap");
+
+    // calls f(range, offset, count) for the part of every range in
+    // [address, address + count), false if there is a gap or f fails.
+    template <typename F>
+    static bool for_each_segment(uint16_t address, uint16_t count, F f) {
+        uint32_t next = address, end = uint32_t(address) + count;
+        for (auto &range : Ranges) {
+            if (next >= end) {
+                break;
+            }
+            if (range.end() <= next) {
+                continue;
+            }
+            if (range.address > next) {
+                return false;
+            }
+            auto n = uint16_t(std::min(range.end(), end) - next);
+            if (!f(range, uint16_t(next - range.address), n)) {
+                return false;
+            }
+            next += n;
+        }
+        return next >= end;
+    }
+
+  public:
+    static constexpr size_t RANGE_COUNT = std::size(Ranges);
+
+    static bool is_readable(uint16_t address, uint16_t count) {
+        return for_each_segment(
+            address, count,
+            [](const RegisterRange &, uint16_t, uint16_t) { return true; });
+    }
+    static bool is_writable(uint16_t address, uint16_t count) {
+        return for_each_segment(
+            address, count,
+            [](const RegisterRange &range, uint16_t, uint16_t) {
+                return range.writable;
+            });
+    }
+    static bool read(uint16_t address, uint16_t count, RegisterWords words) {
+        auto bytes = words.data();
+        return for_each_segment(
+            address, count,
+            [&bytes](const RegisterRange &range, uint16_t offset,
+                     uint16_t n) {
+                switch (range.kind) {
+                case RegisterRange::Kind::ARRAY:
+                    copy_to_big_endian(bytes, &range.array[offset], n);
+                    break;
+                case RegisterRange::Kind::ATOMIC:
+                    for (uint16_t i = 0; i < n; ++i) {
+                        write_big_endian(
+                            &bytes[2 * i],
+                            range.atomics[offset + i].load(
+                                std::memory_order_relaxed));
+                    }
+                    break;
+                case RegisterRange::Kind::CALLBACK:
+                    for (uint16_t i = 0; i < n; ++i) {
+                        uint16_t v;
+                        if (!range.read(range.address + offset + i, &v)) {
+                            return false;
+                        }
+                        write_big_endian(&bytes[2 * i], v);
+                    }
+                    break;
+                }
+                bytes += 2 * n;
+                return true;
+            });
+    }
+    static bool write(uint16_t address, uint16_t count,
+                      ConstRegisterWords words) {
+        auto bytes = words.data();
+        return for_each_segment(
+            address, count,
+            [&bytes](const RegisterRange &range, uint16_t offset,
+                     uint16_t n) {
+                if (!range.writable) {
+                    return false;
+                }
+                switch (range.kind) {
+                case RegisterRange::Kind::ARRAY:
+                    copy_from_big_endian(&range.array[offset], bytes, n);
+                    break;
+                case RegisterRange::Kind::ATOMIC:
+                    for (uint16_t i = 0; i < n; ++i) {
+                        range.atomics[offset + i].store(
+                            read_big_endian(&bytes[2 * i]),
+                            std::memory_order_relaxed);
+                    }
+                    break;
+                case RegisterRange::Kind::CALLBACK:
+                    for (uint16_t i = 0; i < n; ++i) {
+                        if (!range.write(range.address + offset + i,
+                                         read_big_endian(&bytes[2 * i]))) {
+                            return false;
+                        }
+                    }
+                    break;
+                }
+                bytes += 2 * n;
+                return true;
+            });
+    }
+};
+
+} // namespace vla
+
+#endif // VLA_REGISTER_MAP_HPP
@@ -0,0 +1,104 @@
+#ifndef VLA_REPLY_CACHE_HPP
+#define VLA_REPLY_CACHE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <vla/hw_timer.hpp>
+#include <vla/modbus_daemon_fsm.hpp>
+#include <vla/modbus_stats.hpp>
+#include <vla/rtu_message.hpp>
+
+namespace vla {
+
+/**
+ * Handler wrapper that answers a retried request from the reply given
+ * to the original, without running the handler again:
+ *
+ * static auto cached_handler = vla::ReplyCache(rtu_handler, PeriodUs(50000));
+ * vla::modbus_daemon(context, transport, cached_handler);
+ *
+ * A master resends a request when the reply got lost, and does so
+ * before sending anything else. So only the last exchange is kept: a
+ * frame is a retry if it is byte for byte, CRC included, the last
+ * indication and arrives within window of its reply. Remembering
+ * older exchanges would replay a stale reply after A, B, A writes.
+ *
+ * Keep the window shorter than the master poll period, or the
+ * identical requests of a poll loop are answered from the cache too.
+ * Broadcasts, exception replies and frames longer than FrameMax are
+ * not kept, and neither are the replies of the UNCACHED functions: they
+ * report counters, or stream objects, that must be read anew.
+ */
+template <typename Handler, uint16_t FrameMax = PDU_MAX> class ReplyCache {
+    static constexpr FunctionSet UNCACHED =
+        RtuFunctionCode::DIAGNOSTIC | RtuFunctionCode::GET_COM_EVENT_COUNTER |
+        RtuFunctionCode::GET_COM_EVENT_LOG |
+        RtuFunctionCode::READ_DEVICE_IDENTIFICATION;
+
+    Handler &handler;
+    const PeriodUs window;
+    ModbusStats *stats = nullptr;
+    bool valid         = false;
+    uint64_t stored_at = 0;
+    uint16_t indication_length;
+    uint16_t reply_length;
+    uint8_t indication[FrameMax];
+    uint8_t reply_buffer[FrameMax];
+
+    bool is_retry(const RtuMessage &msg, uint64_t now) const {
+        return valid && now - stored_at <= window.us &&
+               msg.length == indication_length &&
+               !std::memcmp(msg.buffer, indication, msg.length);
+    }
+
+  public:
+    ReplyCache(Handler &handler, PeriodUs window)
+        : handler(handler), window(window) {
+    }
+    void attach_stats(ModbusStats *s) {
+        stats = s;
+        if constexpr (HasAttachStats<Handler>::value) {
+            handler.attach_stats(s);
+        }
+    }
+    template <typename H = Handler, typename = ServesCall<H>>
+    bool serves(RtuAddress addr) {
+        return handler.serves(addr);
+    }
+    // forget the last exchange, e.g. after the registers were changed
+    // by other means.
+    void clear() {
+        valid = false;
+    }
+    void operator()(const RtuMessage &msg, RtuMessage &reply) {
+        auto now = now_us();
+        if (is_retry(msg, now)) {
+            std::memcpy(reply.buffer, reply_buffer, reply_length);
+            reply.length = reply_length;
+            if (stats) {
+                ++stats->reply_cache_hits;
+            }
+            return;
+        }
+        // reply and indication may share the buffer, keep the key first.
+        // Broadcasts are never retried, they get no reply.
+        valid = msg.length <= FrameMax && msg.address() != RtuAddress(0) &&
+                !UNCACHED.contains(msg.function_code());
+        if (valid) {
+            std::memcpy(indication, msg.buffer, msg.length);
+            indication_length = msg.length;
+        }
+        handler(msg, reply);
+        valid = valid && must_transmit(reply) && reply.length <= FrameMax &&
+                !(reply.buffer[1] & 0x80);
+        if (valid) {
+            std::memcpy(reply_buffer, reply.buffer, reply.length);
+            reply_length = reply.length;
+            stored_at    = now_us();
+        }
+    }
+};
+
+} // namespace vla
+
+#endif // VLA_REPLY_CACHE_HPP
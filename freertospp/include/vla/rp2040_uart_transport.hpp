@@ -0,0 +1,66 @@
+#ifndef VLA_RP2040_UART_TRANSPORT_HPP
+#define VLA_RP2040_UART_TRANSPORT_HPP
+
+#include <cstdint>
+#include <vla/modbus_daemon.hpp>
+#include <vla/rtu_timing.hpp>
+
+namespace vla {
+
+/**
+ * Interrupt driven transport over one of the RP2040 UARTs, meant for
+ * RS-485 lines.
+ *
+ * The FIFOs are disabled so that every received char raises its own
+ * interrupt and gets an accurate arrival timestamp. Transmission is
+ * interrupt driven as well. Once the last char has been shifted out
+ * the driver enable pin, if any, is released and BytesWritten is sent.
+ * Chars received while transmitting are discarded: on a half duplex
+ * line they are our own echo. A framing, parity, break or overrun
+ * error discards the frame the char belongs to.
+ */
+class Rp2040UartTransport {
+  public:
+    struct Config {
+        uint8_t uart_index;
+        uint8_t tx_pin;
+        uint8_t rx_pin;
+        uint32_t baud_rate;
+        Parity parity     = Parity::EVEN;
+        uint8_t stop_bits = 1;
+        // RS-485 driver enable, active high. Negative if not used.
+        int8_t de_pin = -1;
+    };
+
+    Rp2040UartTransport(const Config &config);
+    Rp2040UartTransport(const Rp2040UartTransport &) = delete;
+    Rp2040UartTransport &operator=(const Rp2040UartTransport &) = delete;
+
+    RtuTiming timing() const {
+        return RtuTiming::for_line(config.baud_rate, config.parity,
+                                   config.stop_bits);
+    }
+    void start(RxSink &sink);
+    void write(const uint8_t *data, uint16_t length, ModbusDaemonQueue &q);
+
+  private:
+    Config config;
+    // one char time, used to poll for the end of the transmission
+    PeriodUs char_time;
+    RxSink *sink = nullptr;
+    ModbusDaemonQueue *tx_q = nullptr;
+    const uint8_t *volatile tx_data = nullptr;
+    volatile uint16_t tx_left       = 0;
+    uint16_t tx_length              = 0;
+    volatile bool transmitting      = false;
+
+    static void on_uart0_irq();
+    static void on_uart1_irq();
+    static int64_t on_tx_drain(AlarmId, void *data);
+    void on_irq();
+    void end_transmission(BaseType_t *taskWoken);
+};
+
+} // namespace vla
+
+#endif // VLA_RP2040_UART_TRANSPORT_HPP
@@ -0,0 +1,33 @@
+#ifndef VLA_RP2040_USB_CDC_TRANSPORT_HPP
+#define VLA_RP2040_USB_CDC_TRANSPORT_HPP
+
+#include <vla/modbus_daemon.hpp>
+
+namespace vla {
+
+/**
+ * Transport over the USB CDC stdio driver. It talks to the driver
+ * directly, so neither the output manager task nor the stdio CRLF
+ * translation sit between the daemon and the line. Received chars are
+ * read when the driver reports them available, with a slow poll as a
+ * safety net. Drivers built without that notification are polled
+ * every 500us instead.
+ */
+class Rp2040UsbCdcTransport {
+  public:
+    Rp2040UsbCdcTransport();
+    Rp2040UsbCdcTransport(const Rp2040UsbCdcTransport &) = delete;
+    Rp2040UsbCdcTransport &operator=(const Rp2040UsbCdcTransport &) = delete;
+
+    void start(RxSink &sink);
+    void write(const uint8_t *data, uint16_t length, ModbusDaemonQueue &q);
+
+  private:
+    static PeriodUs poll_period;
+    static void drain(RxSink &sink, void *data, BaseType_t *taskWoken);
+    static void on_chars_available(void *data);
+};
+
+} // namespace vla
+
+#endif // VLA_RP2040_USB_CDC_TRANSPORT_HPP
@@ -0,0 +1,167 @@
+#ifndef VLA_RTU_FRAME_HPP
+#define VLA_RTU_FRAME_HPP
+
+#include <cstdint>
+#include <optional>
+#include <vla/crc16.hpp>
+#include <vla/hw_timer.hpp>
+#include <vla/queue.hpp>
+#include <vla/rtu_message.hpp>
+
+namespace vla {
+
+// address, function code and CRC
+constexpr uint16_t RTU_FRAME_MIN = 4;
+
+/**
+ * A complete RTU frame as delivered by the RX side. first and last
+ * are the arrival timestamps, in microseconds, of the first and last
+ * chars of the frame. crc is the running CRC over the whole frame,
+ * its own CRC included, so it is 0 for an intact frame. buffer comes
+ * from a FramePool and whoever receives the frame must release it.
+ */
+struct FrameReceived {
+    uint8_t *buffer;
+    uint16_t length;
+    uint16_t crc;
+    uint64_t first;
+    uint64_t last;
+    bool is_intact() const {
+        return length >= RTU_FRAME_MIN && crc == 0;
+    }
+};
+
+#ifndef MODBUS_FRAME_BUFFERS
+#define MODBUS_FRAME_BUFFERS 3
+#endif
+
+/**
+ * Frame memory shared by the RX side and the daemon. A buffer is taken
+ * when the first char of an indication arrives, the reply is built in
+ * place and the buffer goes back to the pool once the reply has been
+ * written out. With three buffers one frame can be received while
+ * another one is being handled and a third one is still being sent.
+ */
+class FramePool {
+    uint8_t buffers[MODBUS_FRAME_BUFFERS][PDU_MAX];
+    Queue<uint8_t *> free;
+
+  public:
+    FramePool() : free(MODBUS_FRAME_BUFFERS) {
+        for (auto &buffer : buffers) {
+            free.send(buffer, 0);
+        }
+    }
+    FramePool(const FramePool &) = delete;
+    FramePool &operator=(const FramePool &) = delete;
+    // nullptr if all the buffers are in use
+    uint8_t *acquire() {
+        uint8_t *buffer = nullptr;
+        free.receive(buffer, 0);
+        return buffer;
+    }
+    uint8_t *acquire_from_isr() {
+        uint8_t *buffer = nullptr;
+        free.receiveFromIsr(buffer);
+        return buffer;
+    }
+    void release(uint8_t *buffer) {
+        free.send(buffer, 0);
+    }
+    void release_from_isr(uint8_t *buffer) {
+        free.sendFromIsr(buffer);
+    }
+};
+
+/**
+ * Assembles received chars into frames on the RX side (ISR or timer
+ * context) so that the daemon gets a single FrameReceived per frame
+ * instead of one ReadChar per char.
+ *
+ * Each frame is assembled in its own FramePool buffer, which the
+ * daemon releases once it is done with it. The CRC is updated as
+ * chars arrive so that it is already known when the end of the frame
+ * is detected.
+ */
+class FrameAssembler {
+    FramePool &pool;
+    PeriodUs inter_char_delay;
+    uint8_t *buffer = nullptr;
+    uint16_t length = 0;
+    // chars received in the current frame, stored or not
+    uint16_t chars = 0;
+    // set when the frame must be discarded: a char had a line error
+    // or came more than inter_char_delay after the previous one, it is
+    // longer than PDU_MAX or there was no free buffer when it started.
+    bool broken    = false;
+    uint16_t crc   = crc16::INIT;
+    uint64_t first = 0;
+    uint64_t last  = 0;
+
+  public:
+    FrameAssembler(FramePool &pool, PeriodUs inter_char_delay)
+        : pool(pool), inter_char_delay(inter_char_delay) {
+    }
+    // error tells that the UART reported a line error for chr.
+    void append(uint64_t when, uint8_t chr, bool error = false) {
+        if (!in_frame()) {
+            first  = when;
+            buffer = pool.acquire_from_isr();
+            broken = !buffer;
+        } else if (when - last > inter_char_delay.us) {
+            broken = true;
+        }
+        last = when;
+        if (chars < UINT16_MAX) {
+            ++chars;
+        }
+        if (error) {
+            broken = true;
+        }
+        if (broken) {
+            return;
+        }
+        if (length < PDU_MAX) {
+            buffer[length++] = chr;
+            crc              = crc16::update(crc, chr);
+        } else {
+            broken = true;
+        }
+    }
+    bool in_frame() const {
+        return chars;
+    }
+    // the frame is over once the line has been silent for at least
+    // inter_frame_delay since the arrival of the last char.
+    uint64_t deadline(PeriodUs inter_frame_delay) const {
+        return last + inter_frame_delay.us;
+    }
+    bool is_complete(uint64_t now, PeriodUs inter_frame_delay) const {
+        return in_frame() && now >= deadline(inter_frame_delay);
+    }
+    // discarded frames give their buffer back to the pool right away,
+    // the number of chars they had is stored in dropped.
+    std::optional<FrameReceived> take(uint16_t *dropped = nullptr) {
+        std::optional<FrameReceived> frame;
+        if (!broken) {
+            frame = FrameReceived{buffer, length, crc, first, last};
+        } else {
+            if (buffer) {
+                pool.release_from_isr(buffer);
+            }
+            if (dropped) {
+                *dropped = chars;
+            }
+        }
+        buffer   = nullptr;
+        length   = 0;
+        chars    = 0;
+        broken   = false;
+        crc      = crc16::INIT;
+        return frame;
+    }
+};
+
+} // namespace vla
+
+#endif // VLA_RTU_FRAME_HPP
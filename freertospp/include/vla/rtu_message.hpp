@@ -47,6 +47,55 @@ enum class RtuFunctionCode : uint8_t {
     READ_DEVICE_IDENTIFICATION = 0x2b
 };
 
+// set of function codes, as a bit mask indexed by code
+struct FunctionSet {
+    uint64_t mask;
+    constexpr FunctionSet() : mask(0) {
+    }
+    constexpr FunctionSet(RtuFunctionCode f) : mask(uint64_t(1) << uint8_t(f)) {
+    }
+    static constexpr FunctionSet all() {
+        FunctionSet set;
+        set.mask = ~uint64_t(0);
+        return set;
+    }
+    constexpr bool contains(RtuFunctionCode f) const {
+        return uint8_t(f) < 64 && (mask >> uint8_t(f) & 1);
+    }
+    constexpr FunctionSet &operator|=(FunctionSet right) {
+        mask |= right.mask;
+        return *this;
+    }
+};
+
+constexpr FunctionSet operator|(FunctionSet left, FunctionSet right) {
+    return left |= right;
+}
+
+constexpr FunctionSet operator|(RtuFunctionCode left, RtuFunctionCode right) {
+    return FunctionSet(left) | right;
+}
+
+static_assert((RtuFunctionCode::READ_COILS | RtuFunctionCode::DIAGNOSTIC)
+                  .contains(RtuFunctionCode::DIAGNOSTIC));
+static_assert(!FunctionSet(RtuFunctionCode::READ_COILS)
+                   .contains(RtuFunctionCode::WRITE_COILS));
+
+// sub-functions of DIAGNOSTIC (0x08)
+enum class RtuDiagnosticCode : uint16_t {
+    RETURN_QUERY_DATA                  = 0x00,
+    RESTART_COMMUNICATIONS_OPTION      = 0x01,
+    CLEAR_COUNTERS                     = 0x0a,
+    RETURN_BUS_MESSAGE_COUNT           = 0x0b,
+    RETURN_BUS_COMMUNICATION_ERROR     = 0x0c,
+    RETURN_BUS_EXCEPTION_ERROR_COUNT   = 0x0d,
+    RETURN_SERVER_MESSAGE_COUNT        = 0x0e,
+    RETURN_SERVER_NO_RESPONSE_COUNT    = 0x0f,
+    RETURN_SERVER_NAK_COUNT            = 0x10,
+    RETURN_SERVER_BUSY_COUNT           = 0x11,
+    RETURN_BUS_CHARACTER_OVERRUN_COUNT = 0x12
+};
+
 enum class RtuExceptionCode : uint8_t {
     ILLEGAL_FUNCTION                 = 0x01,
     ILLEGAL_DATA_ADDRESS             = 0x02,
@@ -54,6 +103,7 @@ enum class RtuExceptionCode : uint8_t {
     SERVER_DEVICE_FAILURE            = 0x04,
     ACKNOLEDGE                       = 0x05,
     SERVER_DEVICE_BUSY               = 0x06,
+    NEGATIVE_ACKNOWLEDGE             = 0x07,
     MEMORY_PARITY_ERROR              = 0x08,
     GATEWAY_PATH_UNAVAILABLE         = 0x0a,
     GATEWAY_TARGET_FAILED_TO_RESPOND = 0x0b
@@ -61,9 +111,9 @@ enum class RtuExceptionCode : uint8_t {
 
 struct RtuMessage {
     uint8_t *buffer;
-    uint8_t length;
+    uint16_t length;
     RtuMessage() = default;
-    RtuMessage(uint8_t *b, uint8_t l) : buffer{b}, length{l} {
+    RtuMessage(uint8_t *b, uint16_t l) : buffer{b}, length{l} {
     }
     RtuAddress address() const {
         return RtuAddress{buffer[0]};
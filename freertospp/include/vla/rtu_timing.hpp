@@ -0,0 +1,70 @@
+#ifndef VLA_RTU_TIMING_HPP
+#define VLA_RTU_TIMING_HPP
+
+#include <cstdint>
+#include <vla/hw_timer.hpp>
+
+namespace vla {
+
+enum class Parity : uint8_t { NONE, EVEN, ODD };
+
+/**
+ * Modbus RTU silent intervals: t1.5 is the longest gap allowed between
+ * two chars of a frame and t3.5 the silence that delimits frames.
+ *
+ * for_line derives them from the line settings. Up to 19200 baud they
+ * are 1.5 and 3.5 char times; above that the spec fixes them at 750
+ * and 1750 us. Everything is constexpr so a profile can be computed
+ * and checked at compile time:
+ *
+ * constexpr auto timing = vla::RtuTiming::for_line(9600, vla::Parity::EVEN);
+ * static_assert(timing.inter_frame_delay.us == 4011);
+ */
+struct RtuTiming {
+    PeriodUs inter_char_delay;  // t1.5
+    PeriodUs inter_frame_delay; // t3.5
+
+    static constexpr uint32_t HIGH_SPEED_BAUD_RATE = 19200;
+
+    constexpr RtuTiming(PeriodUs t15, PeriodUs t35)
+        : inter_char_delay(t15), inter_frame_delay(t35) {
+    }
+
+    // start bit + 8 data bits + parity + stop bits
+    static constexpr uint32_t char_bits(Parity parity, uint8_t stop_bits) {
+        return 1 + 8 + (parity != Parity::NONE ? 1 : 0) + stop_bits;
+    }
+
+    static constexpr RtuTiming for_line(uint32_t baud_rate,
+                                        Parity parity     = Parity::EVEN,
+                                        uint8_t stop_bits = 1) {
+        if (baud_rate > HIGH_SPEED_BAUD_RATE) {
+            return RtuTiming(PeriodUs{750}, PeriodUs{1750});
+        }
+        // half char times, rounded up
+        auto bits = uint64_t(char_bits(parity, stop_bits));
+        return RtuTiming(
+            PeriodUs(uint32_t((bits * 3000000 + 2 * baud_rate - 1) /
+                              (2 * baud_rate))),
+            PeriodUs(uint32_t((bits * 7000000 + 2 * baud_rate - 1) /
+                              (2 * baud_rate))));
+    }
+};
+
+static_assert(RtuTiming::for_line(9600).inter_char_delay.us == 1719);
+static_assert(RtuTiming::for_line(9600).inter_frame_delay.us == 4011);
+static_assert(RtuTiming::for_line(19200, Parity::NONE, 2)
+                  .inter_frame_delay.us == 2006);
+static_assert(RtuTiming::for_line(115200).inter_frame_delay.us == 1750);
+
+#ifdef MODBUS_RTU_STD_TIMEOUTS
+constexpr auto default_rtu_timing = RtuTiming::for_line(115200);
+#else
+// far below the spec, only suitable for links that carry whole frames
+// at once such as USB CDC.
+constexpr auto default_rtu_timing = RtuTiming(PeriodUs{15}, PeriodUs{75});
+#endif
+
+} // namespace vla
+
+#endif // VLA_RTU_TIMING_HPP
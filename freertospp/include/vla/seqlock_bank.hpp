@@ -0,0 +1,85 @@
+#ifndef VLA_SEQLOCK_BANK_HPP
+#define VLA_SEQLOCK_BANK_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <vla/big_endian.hpp>
+
+namespace vla {
+
+/**
+ * Registers shared between one producer, a task or an interrupt
+ * handler, and any number of readers, such as a Modbus handler. Reads
+ * of a whole range are consistent, a 32 bit value or a set of
+ * channels is never half old and half new, and neither side disables
+ * interrupts or takes a lock.
+ *
+ * Two copies are kept, and seq tells the readers which one is stable.
+ * The producer bumps seq to send the readers to copy 1 and updates
+ * copy 0. It then bumps seq again to send them back to copy 0 and
+ * updates copy 1. A reader copies the stable side and retries if seq
+ * moved meanwhile, which only happens if the producer completed a
+ * step during the copy.
+ *
+ * Only one producer may write at a time.
+ */
+template <uint16_t N> class SeqlockBank {
+    std::atomic<uint32_t> seq{0};
+    uint16_t copies[2][N] = {};
+
+    template <typename Out>
+    void read_into(uint16_t first, uint16_t count, Out &out) const {
+        uint32_t s;
+        do {
+            s = seq.load(std::memory_order_acquire);
+            const uint16_t *copy = copies[s & 1];
+            for (uint16_t i = 0; i < count; ++i) {
+                out[i] = copy[first + i];
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while (seq.load(std::memory_order_relaxed) != s);
+    }
+
+  public:
+    static constexpr uint16_t SIZE = N;
+
+    bool is_valid_data_address(uint16_t first, uint16_t count) const {
+        return uint32_t(first) + count <= N;
+    }
+    void write(uint16_t first, const uint16_t *values, uint16_t count) {
+        auto s = seq.load(std::memory_order_relaxed);
+        for (int side = 0; side < 2; ++side) {
+            // publishes the other side before the readers move to it
+            seq.store(++s, std::memory_order_release);
+            // and keeps the updates below after the move
+            std::atomic_thread_fence(std::memory_order_release);
+            for (uint16_t i = 0; i < count; ++i) {
+                copies[side][first + i] = values[i];
+            }
+        }
+    }
+    void write(uint16_t index, uint16_t value) {
+        write(index, &value, 1);
+    }
+    // high word first, as Modbus masters usually expect
+    void write_u32(uint16_t index, uint32_t value) {
+        uint16_t words[2] = {uint16_t(value >> 16), uint16_t(value)};
+        write(index, words, 2);
+    }
+    uint16_t read(uint16_t index) const {
+        uint16_t v;
+        read(index, 1, &v);
+        return v;
+    }
+    void read(uint16_t first, uint16_t count, uint16_t *values) const {
+        read_into(first, count, values);
+    }
+    // straight into a reply
+    void read(uint16_t first, uint16_t count, RegisterWords words) const {
+        read_into(first, count, words);
+    }
+};
+
+} // namespace vla
+
+#endif // VLA_SEQLOCK_BANK_HPP
@@ -17,6 +17,10 @@ class Task {
         bool operator!=(ClosureHandle other) const {
             return handle != other.handle;
         }
+        // unique_ptr tests the pointer before deleting it
+        explicit operator bool() const {
+            return handle != nullptr;
+        }
     };
     struct ClosureDeleter {
         using pointer = ClosureHandle;
@@ -0,0 +1,110 @@
+#ifndef VLA_UNIT_DISPATCHER_HPP
+#define VLA_UNIT_DISPATCHER_HPP
+
+#include <FreeRTOS.h>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vla/modbus_daemon_fsm.hpp>
+#include <vla/modbus_stats.hpp>
+#include <vla/rtu_message.hpp>
+
+namespace vla {
+
+// handler serves unit Id, it must have been built for that address:
+// UnitDispatcher asserts it for handlers that tell (see HasServes).
+template <uint8_t Id, auto &Handler> struct Unit {
+    static_assert(Id >= 1 && Id <= 247, "unit ids go from 1 to 247");
+    static constexpr uint8_t ID = Id;
+    static constexpr auto &handler = Handler;
+};
+
+template <typename... Units> constexpr bool are_unit_ids_unique() {
+    constexpr uint8_t ids[] = {Units::ID...};
+    for (size_t i = 0; i < sizeof...(Units); ++i) {
+        for (size_t j = 0; j < i; ++j) {
+            if (ids[i] == ids[j]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Serves several unit ids, each with its own handler, from a single
+ * daemon, so one board can show up as several slaves on the line:
+ *
+ * static auto pumps   = PumpHandler(vla::RtuAddress(1));
+ * static auto sensors = SensorHandler(vla::RtuAddress(2));
+ * static auto units   = vla::UnitDispatcher<vla::Unit<1, pumps>,
+ *                                           vla::Unit<2, sensors>>();
+ * vla::modbus_daemon(context, transport, units);
+ *
+ * The table is fixed at compile time and each handler is called
+ * directly, so the dispatch is a compare per unit and the handlers can
+ * still be inlined. Frames for other addresses get no reply.
+ * Broadcasts are handed to every unit in turn, each from its own copy
+ * of the indication, and never answered. Build the dispatcher after
+ * its handlers, it checks their addresses.
+ */
+template <typename... Units> class UnitDispatcher {
+    static_assert(sizeof...(Units) > 0, "at least one unit");
+    static_assert(are_unit_ids_unique<Units...>(), "unit ids must be unique");
+
+    // the units handle a broadcast in place, one after the other
+    uint8_t broadcast[PDU_MAX];
+
+    template <typename U> static void attach_unit_stats(ModbusStats *s) {
+        using Handler = std::remove_reference_t<decltype(U::handler)>;
+        if constexpr (HasAttachStats<Handler>::value) {
+            U::handler.attach_stats(s);
+        }
+    }
+    // a handler built for another address would ignore every frame
+    template <typename U> static void check_unit_address() {
+        using Handler = std::remove_reference_t<decltype(U::handler)>;
+        if constexpr (HasServes<Handler>::value) {
+            configASSERT(U::handler.serves(RtuAddress(U::ID)));
+        }
+    }
+    template <typename U>
+    bool dispatch(const RtuMessage &msg, RtuMessage &reply) {
+        if (msg.address() != RtuAddress(U::ID)) {
+            return false;
+        }
+        U::handler(msg, reply);
+        return true;
+    }
+    template <typename U> void dispatch_broadcast(const RtuMessage &msg) {
+        std::memcpy(broadcast, msg.buffer, msg.length);
+        auto copy = RtuMessage(broadcast, msg.length);
+        U::handler(copy, copy);
+    }
+
+  public:
+    UnitDispatcher() {
+        (check_unit_address<Units>(), ...);
+    }
+    // the counters describe the line, all the units share them.
+    void attach_stats(ModbusStats *s) {
+        (attach_unit_stats<Units>(s), ...);
+    }
+    bool serves(RtuAddress addr) const {
+        return ((addr == RtuAddress(Units::ID)) || ...);
+    }
+    void operator()(const RtuMessage &msg, RtuMessage &reply) {
+        if (msg.address() == RtuAddress(0)) {
+            (dispatch_broadcast<Units>(msg), ...);
+            reply.length = 0;
+            return;
+        }
+        if (!(dispatch<Units>(msg, reply) || ...)) {
+            reply.length = 0;
+        }
+    }
+};
+
+} // namespace vla
+
+#endif // VLA_UNIT_DISPATCHER_HPP
@@ -3,6 +3,8 @@
 #include <hardware/irq.h>
 #include <iostream>
 #include <vla/adc.hpp>
+#include <vla/adc_capture.hpp>
+#include <vla/seqlock_bank.hpp>
 
 namespace vla {
 namespace adc {
@@ -12,7 +14,10 @@ static std::atomic<AdcMask> active_channels;
 constexpr uint8_t ADC_PIN_BASE      = 26;
 constexpr uint16_t SAMPLE_ERROR_BIT = 1 << 12;
 
-static uint16_t samples[CHANNEL_COUNT];
+// written by the interrupt handler only, a whole round-robin pass at a
+// time
+static SeqlockBank<CHANNEL_COUNT> samples;
+static uint16_t pass[CHANNEL_COUNT];
 
 static uint8_t get_read_input(uint8_t next_input) {
     auto ac            = active_channels.load();
@@ -31,10 +36,16 @@ static void on_adc_ready() {
     ++irq_count[read_input];
     uint16_t v = adc_fifo_get();
     if (!(SAMPLE_ERROR_BIT & v)) {
-        samples[read_input] = v;
+        pass[read_input] = v;
+        detail::capture_sample(read_input, v);
     } else {
         ++err_count[read_input];
     }
+    // the round robin goes up the active channels, the highest one
+    // completes the pass
+    if (!(active_channels.load().mask >> read_input >> 1)) {
+        samples.write(0, pass, CHANNEL_COUNT);
+    }
     adc_fifo_drain();
 }
 
@@ -91,7 +102,22 @@ std::optional<uint16_t> read(AdcInput channel) {
     if (!(channel & active_channels)) {
         return std::nullopt;
     }
-    return samples[uint8_t(channel)];
+    return samples.read(uint8_t(channel));
+}
+
+bool read(AdcInput first, uint8_t count, uint16_t *values,
+          uint16_t inactive_value) {
+    if (uint8_t(first) + count > CHANNEL_COUNT) {
+        return false;
+    }
+    auto ac = active_channels.load();
+    samples.read(uint8_t(first), count, values);
+    for (uint8_t i = 0; i < count; ++i) {
+        if (!(ac & AdcInput(uint8_t(first) + i))) {
+            values[i] = inactive_value;
+        }
+    }
+    return true;
 }
 
 std::ostream &operator<<(std::ostream &ost, AdcInput adci) {
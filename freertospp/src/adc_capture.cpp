@@ -0,0 +1,173 @@
+#include <atomic>
+#include <vla/adc_capture.hpp>
+
+namespace vla {
+namespace adc {
+
+// The ADC interrupt is the only writer of the buffers and of the
+// positions while the capture is ARMED or TRIGGERED. Tasks only touch
+// them when it is IDLE or DONE, state tells them apart.
+static std::atomic<CaptureState> state{CaptureState::IDLE};
+static std::atomic<bool> trigger_requested{false};
+static CaptureConfig config;
+static uint16_t length;
+static uint16_t buffers[CHANNEL_COUNT][CAPTURE_DEPTH];
+// samples recorded per channel since the capture was armed
+static uint32_t recorded[CHANNEL_COUNT];
+// value of recorded at which each channel stops, once triggered
+static uint32_t stop_at[CHANNEL_COUNT];
+// channels still recording after the trigger
+static uint8_t recording;
+static uint16_t previous;
+
+static bool is_trigger(uint16_t value) {
+    switch (config.mode) {
+    case TriggerMode::LEVEL_ABOVE:
+        return value > config.threshold;
+    case TriggerMode::LEVEL_BELOW:
+        return value < config.threshold;
+    case TriggerMode::RISING_EDGE:
+        return previous <= config.threshold && value > config.threshold;
+    case TriggerMode::FALLING_EDGE:
+        return previous >= config.threshold && value < config.threshold;
+    case TriggerMode::MANUAL:
+        break;
+    }
+    return false;
+}
+
+// the interrupt is the only consumer of the request, so a load and a
+// store will do. An exchange would pull in libatomic on the M0+.
+static bool take_trigger_request() {
+    if (!trigger_requested.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    trigger_requested.store(false, std::memory_order_relaxed);
+    return true;
+}
+
+// the last sample of the trigger channel is the first post trigger one
+static void fire() {
+    recording = 0;
+    for (uint8_t c = 0; c < CHANNEL_COUNT; ++c) {
+        stop_at[c] = recorded[c] ? recorded[c] - 1 + config.post_trigger : 0;
+        if (stop_at[c] && recorded[c] != stop_at[c]) {
+            ++recording;
+        }
+    }
+    state.store(recording ? CaptureState::TRIGGERED : CaptureState::DONE,
+                std::memory_order_release);
+}
+
+namespace detail {
+
+void capture_sample(uint8_t channel, uint16_t value) {
+    auto s = state.load(std::memory_order_relaxed);
+    if (s != CaptureState::ARMED && s != CaptureState::TRIGGERED) {
+        return;
+    }
+    if (s == CaptureState::TRIGGERED) {
+        // channels first sampled after the trigger are not part of it
+        if (!stop_at[channel] || recorded[channel] == stop_at[channel]) {
+            return;
+        }
+    }
+    buffers[channel][recorded[channel] % CAPTURE_DEPTH] = value;
+    ++recorded[channel];
+    if (s == CaptureState::TRIGGERED) {
+        if (recorded[channel] == stop_at[channel] && !--recording) {
+            state.store(CaptureState::DONE, std::memory_order_release);
+        }
+        return;
+    }
+    if (channel != uint8_t(config.trigger_channel)) {
+        return;
+    }
+    // channels later in the round are a sample behind, they need their
+    // pre trigger history as well
+    if (recorded[channel] > config.pre_trigger + 1u &&
+        (is_trigger(value) || take_trigger_request())) {
+        fire();
+    }
+    previous = value;
+}
+
+} // namespace detail
+
+bool capture_arm(const CaptureConfig &c) {
+    if (c.post_trigger == 0 ||
+        c.pre_trigger + c.post_trigger > CAPTURE_DEPTH) {
+        return false;
+    }
+    // the interrupt leaves everything alone while IDLE
+    state.store(CaptureState::IDLE, std::memory_order_seq_cst);
+    config = c;
+    length = c.pre_trigger + c.post_trigger;
+    for (uint8_t channel = 0; channel < CHANNEL_COUNT; ++channel) {
+        recorded[channel] = 0;
+        stop_at[channel]  = 0;
+    }
+    trigger_requested.store(false, std::memory_order_relaxed);
+    previous = c.threshold;
+    state.store(CaptureState::ARMED, std::memory_order_release);
+    return true;
+}
+
+void capture_disarm() {
+    state.store(CaptureState::IDLE, std::memory_order_seq_cst);
+}
+
+void capture_trigger() {
+    trigger_requested.store(true, std::memory_order_relaxed);
+}
+
+CaptureState capture_state() {
+    return state.load(std::memory_order_acquire);
+}
+
+uint16_t capture_length() {
+    return capture_state() == CaptureState::DONE ? length : 0;
+}
+
+uint16_t capture_pre_trigger() {
+    return config.pre_trigger;
+}
+
+// position in the ring of sample first of a DONE capture
+static bool capture_start(AdcInput channel, uint16_t first, uint16_t count,
+                          uint32_t *start) {
+    auto c = uint8_t(channel);
+    if (capture_state() != CaptureState::DONE || !stop_at[c] ||
+        recorded[c] != stop_at[c] || uint32_t(first) + count > length) {
+        return false;
+    }
+    *start = stop_at[c] - length + first;
+    return true;
+}
+
+bool capture_read(AdcInput channel, uint16_t first, uint16_t count,
+                  uint16_t *values) {
+    uint32_t start;
+    if (!capture_start(channel, first, count, &start)) {
+        return false;
+    }
+    for (uint16_t i = 0; i < count; ++i) {
+        values[i] = buffers[uint8_t(channel)][(start + i) % CAPTURE_DEPTH];
+    }
+    return true;
+}
+
+bool capture_read(AdcInput channel, uint16_t first, uint16_t count,
+                  RegisterWords words) {
+    uint32_t start;
+    if (!capture_start(channel, first, count, &start)) {
+        return false;
+    }
+    for (uint16_t i = 0; i < count; ++i) {
+        words[i] = buffers[uint8_t(channel)][(start + i) % CAPTURE_DEPTH];
+    }
+    return true;
+}
+
+} // namespace adc
+} // namespace vla
@@ -0,0 +1,10 @@
+#include <vla/crc16.h>
+#include <vla/crc16.hpp>
+
+uint16_t vla_modbus_crc16(const uint8_t *buf, uint16_t len) {
+    return vla::crc16::update<VLA_CRC16_SLICES>(vla::crc16::INIT, buf, len);
+}
+
+uint16_t vla_modbus_crc16_update(uint16_t crc, uint8_t byte) {
+    return vla::crc16::update(crc, byte);
+}
@@ -1,3 +1,4 @@
+#include <hardware/sync.h>
 #include <pico/stdlib.h>
 #include <unistd.h>
 #include <vla/hw_timer.hpp>
@@ -5,30 +6,48 @@
 
 namespace vla {
 
-void get_chars_stdin_timer(ModbusDaemonQueue::SenderIsr *q) {
+#ifndef MODBUS_STDIO_POLL_PERIOD_US
+#define MODBUS_STDIO_POLL_PERIOD_US 10000
+#endif
+
+// RX is driven by the stdio chars available notification. The poll is
+// only a fallback for drivers that do not notify, so it can be slow.
+static constexpr auto stdin_poll_period =
+    PeriodUs{MODBUS_STDIO_POLL_PERIOD_US};
+
+static void drain_stdin(RxSink &sink, void *, BaseType_t *taskWoken) {
+    auto chr = getchar_timeout_us(0);
+    while (chr >= 0) {
+        sink.push(time_us_64(), chr, taskWoken);
+        chr = getchar_timeout_us(0);
+    }
+}
+
+// called from the driver's IRQ, which may run at a lower priority than
+// the alarms that also drain stdin. Keep them from interleaving pushes
+// into the sink.
+static void on_chars_available(void *data) {
+    BaseType_t taskWoken = pdFALSE;
+    auto status          = save_and_disable_interrupts();
+    drain_stdin(*static_cast<RxSink *>(data), nullptr, &taskWoken);
+    restore_interrupts(status);
+    portYIELD_FROM_ISR(taskWoken);
+}
+
+void StdioTransport::start(RxSink &sink) {
     static AlarmId id;
     if (id) {
         return;
     }
     auto handler = [](AlarmId, void *d) -> int64_t {
-        BaseType_t taskWoken;
-        auto q   = static_cast<ModbusDaemonQueue::SenderIsr *>(d);
-        auto chr = getchar_timeout_us(0);
-        while (chr >= 0) {
-            q->send(ReadChar(time_us_64(), chr), &taskWoken);
-            chr = getchar_timeout_us(0);
-        }
-        return -500;
+        BaseType_t taskWoken = pdFALSE;
+        drain_stdin(*static_cast<RxSink *>(d), nullptr, &taskWoken);
+        portYIELD_FROM_ISR(taskWoken);
+        return -int64_t(stdin_poll_period.us);
     };
-    vla::set_alarm(PeriodUs(500), handler, q);
-}
-
-void modbus_daemon_stdin(vla::serial_io::OutputQueue::Sender outq,
-                         RtuMessageHandler handle_indication) {
-    ModbusDaemonQueue q{32};
-    auto sender_isr = q.sender_isr();
-    get_chars_stdin_timer(&sender_isr);
-    modbus_daemon(q, outq, handle_indication);
+    sink.set_drain(drain_stdin, nullptr);
+    stdio_set_chars_available_callback(on_chars_available, &sink);
+    id = vla::set_alarm(stdin_poll_period, handler, &sink);
 }
 
 } // namespace vla
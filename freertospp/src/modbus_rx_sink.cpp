@@ -0,0 +1,60 @@
+#include <vla/hw_timer.hpp>
+#include <vla/modbus_daemon.hpp>
+
+namespace vla {
+
+RxSink::RxSink(ModbusDaemonQueue &q, FramePool &pool, ModbusStats &stats,
+               RxMode mode, const RtuTiming &timing)
+    : q(q.sender_isr()), pool(pool), stats(stats), mode(mode),
+      inter_frame_delay(timing.inter_frame_delay),
+      frame(pool, timing.inter_char_delay) {
+}
+
+void RxSink::receive(uint64_t when, uint8_t chr, bool error,
+                     BaseType_t *taskWoken) {
+    if (mode == RxMode::CHARS) {
+        if (!q.send(ReadChar(when, chr, error), taskWoken)) {
+            ++stats.bytes_dropped;
+            ++stats.queue_overflows;
+        }
+        return;
+    }
+    frame.append(when, chr, error);
+    if (!deadline_armed) {
+        // the alarm fires at the deadline of this first char and moves
+        // itself to the deadline of the last one until it is reached.
+        deadline_armed = true;
+        set_alarm(inter_frame_delay, on_deadline, this);
+    }
+}
+
+int64_t RxSink::on_deadline(AlarmId, void *data) {
+    auto sink            = static_cast<RxSink *>(data);
+    BaseType_t taskWoken = pdFALSE;
+    if (sink->drain) {
+        sink->drain(*sink, sink->drain_data, &taskWoken);
+    }
+    auto now      = now_us();
+    auto deadline = sink->frame.deadline(sink->inter_frame_delay);
+    if (now < deadline) {
+        portYIELD_FROM_ISR(taskWoken);
+        return int64_t(deadline - now);
+    }
+    uint16_t dropped = 0;
+    auto frame       = sink->frame.take(&dropped);
+    if (dropped) {
+        ++sink->stats.framing_errors;
+    }
+    if (frame && !sink->q.send(*frame, &taskWoken)) {
+        // the daemon is not keeping up
+        dropped = frame->length;
+        ++sink->stats.queue_overflows;
+        sink->pool.release_from_isr(frame->buffer);
+    }
+    sink->stats.bytes_dropped += dropped;
+    sink->deadline_armed = false;
+    portYIELD_FROM_ISR(taskWoken);
+    return 0;
+}
+
+} // namespace vla
@@ -0,0 +1,62 @@
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <vla/posix_fd_transport.hpp>
+
+namespace vla {
+
+static constexpr auto fd_poll_period = PeriodUs{1000};
+
+PosixFdTransport::PosixFdTransport(int fd) : fd(fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+void PosixFdTransport::drain(RxSink &sink, void *data,
+                             BaseType_t *taskWoken) {
+    auto transport = static_cast<PosixFdTransport *>(data);
+    uint8_t chars[64];
+    auto count = read(transport->fd, chars, sizeof(chars));
+    while (count > 0) {
+        auto now = now_us();
+        for (ssize_t i = 0; i < count; ++i) {
+            sink.push(now, chars[i], taskWoken);
+        }
+        count = read(transport->fd, chars, sizeof(chars));
+    }
+}
+
+void PosixFdTransport::start(RxSink &s) {
+    auto handler = [](AlarmId, void *d) -> int64_t {
+        auto transport       = static_cast<PosixFdTransport *>(d);
+        BaseType_t taskWoken = pdFALSE;
+        drain(*transport->sink, transport, &taskWoken);
+        portYIELD_FROM_ISR(taskWoken);
+        return -int64_t(fd_poll_period.us);
+    };
+    sink = &s;
+    sink->set_drain(drain, this);
+    set_alarm(fd_poll_period, handler, this);
+}
+
+void PosixFdTransport::write(const uint8_t *data, uint16_t length,
+                             ModbusDaemonQueue &q) {
+    uint16_t written = 0;
+    while (written < length) {
+        auto count = ::write(fd, data + written, length - written);
+        if (count > 0) {
+            written += count;
+        } else if (count < 0 && errno == EAGAIN) {
+            // wait for room rather than spin on the non blocking fd
+            auto out = pollfd{fd, POLLOUT, 0};
+            if (poll(&out, 1, -1) < 0 && errno != EINTR) {
+                break;
+            }
+        } else if (count < 0 && errno != EINTR) {
+            break;
+        }
+    }
+    q.send(serial_io::BytesWritten(written));
+}
+
+} // namespace vla
@@ -0,0 +1,86 @@
+#include <FreeRTOS.h>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <task.h>
+#include <timers.h>
+#include <vla/hw_timer.hpp>
+
+// hw_timer on top of FreeRTOS software timers, for host builds on the
+// FreeRTOS POSIX port. Alarms have tick resolution and their callbacks
+// run in the timer service task.
+namespace vla {
+
+struct HostAlarm {
+    AlarmCb cb;
+    void *data;
+    TimerHandle_t timer;
+};
+
+static std::map<int32_t, HostAlarm> alarms;
+static int32_t last_id = 0;
+
+static TickType_t to_ticks(uint64_t us) {
+    constexpr uint64_t tick_us = 1000000 / configTICK_RATE_HZ;
+    auto ticks                 = TickType_t((us + tick_us - 1) / tick_us);
+    return ticks ? ticks : 1;
+}
+
+static void on_timer(TimerHandle_t timer) {
+    auto id = int32_t(intptr_t(pvTimerGetTimerID(timer)));
+    taskENTER_CRITICAL();
+    auto it         = alarms.find(id);
+    auto found      = it != alarms.end();
+    HostAlarm alarm = found ? it->second : HostAlarm{};
+    taskEXIT_CRITICAL();
+    if (!found) {
+        return;
+    }
+    auto next = alarm.cb(AlarmId(id), alarm.data);
+    if (next) {
+        xTimerChangePeriod(timer, to_ticks(next < 0 ? -next : next), 0);
+        return;
+    }
+    taskENTER_CRITICAL();
+    alarms.erase(id);
+    taskEXIT_CRITICAL();
+    xTimerDelete(timer, 0);
+}
+
+AlarmId set_alarm(PeriodUs us, AlarmCb cb, void *data) {
+    taskENTER_CRITICAL();
+    auto id = ++last_id;
+    taskEXIT_CRITICAL();
+    auto timer = xTimerCreate("alarm", to_ticks(us.us), pdFALSE,
+                              reinterpret_cast<void *>(intptr_t(id)),
+                              on_timer);
+    if (!timer) {
+        return AlarmId();
+    }
+    taskENTER_CRITICAL();
+    alarms[id] = HostAlarm{cb, data, timer};
+    taskEXIT_CRITICAL();
+    xTimerStart(timer, 0);
+    return AlarmId(id);
+}
+
+void cancel_alarm(AlarmId id) {
+    taskENTER_CRITICAL();
+    auto it    = alarms.find(id.id);
+    auto timer = it != alarms.end() ? it->second.timer : nullptr;
+    if (timer) {
+        alarms.erase(it);
+    }
+    taskEXIT_CRITICAL();
+    if (timer) {
+        xTimerDelete(timer, 0);
+    }
+}
+
+uint64_t now_us() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+} // namespace vla
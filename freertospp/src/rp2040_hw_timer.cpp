@@ -12,4 +12,8 @@ void cancel_alarm(AlarmId id) {
     ::cancel_alarm(id.id);
 }
 
+uint64_t now_us() {
+    return time_us_64();
+}
+
 } // namespace vla
@@ -0,0 +1,143 @@
+#include <hardware/gpio.h>
+#include <hardware/irq.h>
+#include <hardware/uart.h>
+#include <pico/time.h>
+#include <vla/rp2040_uart_transport.hpp>
+
+namespace vla {
+
+static Rp2040UartTransport *instances[NUM_UARTS];
+
+static uart_parity_t to_uart_parity(Parity parity) {
+    switch (parity) {
+    case Parity::EVEN:
+        return UART_PARITY_EVEN;
+    case Parity::ODD:
+        return UART_PARITY_ODD;
+    default:
+        return UART_PARITY_NONE;
+    }
+}
+
+Rp2040UartTransport::Rp2040UartTransport(const Config &config)
+    : config(config),
+      char_time((RtuTiming::char_bits(config.parity, config.stop_bits) *
+                     1000000 +
+                 config.baud_rate - 1) /
+                config.baud_rate) {
+    auto uart = uart_get_instance(config.uart_index);
+    uart_init(uart, config.baud_rate);
+    uart_set_format(uart, 8, config.stop_bits, to_uart_parity(config.parity));
+    uart_set_hw_flow(uart, false, false);
+    uart_set_translate_crlf(uart, false);
+    uart_set_fifo_enabled(uart, false);
+    gpio_set_function(config.tx_pin, GPIO_FUNC_UART);
+    gpio_set_function(config.rx_pin, GPIO_FUNC_UART);
+    if (config.de_pin >= 0) {
+        gpio_init(config.de_pin);
+        gpio_set_dir(config.de_pin, GPIO_OUT);
+        gpio_put(config.de_pin, 0);
+    }
+}
+
+void Rp2040UartTransport::start(RxSink &s) {
+    auto uart = uart_get_instance(config.uart_index);
+    auto irq  = config.uart_index ? UART1_IRQ : UART0_IRQ;
+    sink      = &s;
+    instances[config.uart_index] = this;
+    irq_set_exclusive_handler(irq, config.uart_index ? on_uart1_irq
+                                                     : on_uart0_irq);
+    irq_set_enabled(irq, true);
+    uart_set_irq_enables(uart, true, false);
+}
+
+void Rp2040UartTransport::write(const uint8_t *data, uint16_t length,
+                                ModbusDaemonQueue &q) {
+    auto uart = uart_get_instance(config.uart_index);
+    if (!length) {
+        q.send(serial_io::BytesWritten(0));
+        return;
+    }
+    tx_q         = &q;
+    tx_length    = length;
+    transmitting = true;
+    if (config.de_pin >= 0) {
+        gpio_put(config.de_pin, 1);
+    }
+    // the TX interrupt is raised when the holding register becomes
+    // empty, not while it is, so the first char primes it. The RX
+    // interrupt sends whatever tx_data points to, so it is published
+    // only once that char is out of the way.
+    uart_putc_raw(uart, data[0]);
+    tx_left = length - 1;
+    tx_data = data + 1;
+    uart_set_irq_enables(uart, true, true);
+}
+
+void Rp2040UartTransport::on_uart0_irq() {
+    instances[0]->on_irq();
+}
+
+void Rp2040UartTransport::on_uart1_irq() {
+    instances[1]->on_irq();
+}
+
+void Rp2040UartTransport::on_irq() {
+    BaseType_t taskWoken = pdFALSE;
+    auto uart            = uart_get_instance(config.uart_index);
+    while (uart_is_readable(uart)) {
+        // uart_getc() would drop the error bits that come along
+        uint32_t dr = uart_get_hw(uart)->dr;
+        if (transmitting) {
+            continue;
+        }
+        if (dr & (UART_UARTDR_OE_BITS | UART_UARTDR_BE_BITS |
+                  UART_UARTDR_PE_BITS | UART_UARTDR_FE_BITS)) {
+            sink->push_error(now_us(), uint8_t(dr), &taskWoken);
+        } else {
+            sink->push(now_us(), uint8_t(dr), &taskWoken);
+        }
+    }
+    if (tx_data) {
+        while (tx_left && uart_is_writable(uart)) {
+            uart_putc_raw(uart, *tx_data++);
+            --tx_left;
+        }
+        if (!tx_left) {
+            // everything is queued but the last char is still being
+            // shifted out.
+            tx_data = nullptr;
+            uart_set_irq_enables(uart, true, false);
+            if (set_alarm(char_time, on_tx_drain, this).id < 0) {
+                // no alarm slot left: the daemon would wait for
+                // BytesWritten forever, so wait the char out here.
+                while (uart_get_hw(uart)->fr & UART_UARTFR_BUSY_BITS) {
+                }
+                end_transmission(&taskWoken);
+            }
+        }
+    }
+    portYIELD_FROM_ISR(taskWoken);
+}
+
+int64_t Rp2040UartTransport::on_tx_drain(AlarmId, void *data) {
+    auto transport = static_cast<Rp2040UartTransport *>(data);
+    auto uart      = uart_get_instance(transport->config.uart_index);
+    if (uart_get_hw(uart)->fr & UART_UARTFR_BUSY_BITS) {
+        return transport->char_time.us;
+    }
+    BaseType_t taskWoken = pdFALSE;
+    transport->end_transmission(&taskWoken);
+    portYIELD_FROM_ISR(taskWoken);
+    return 0;
+}
+
+void Rp2040UartTransport::end_transmission(BaseType_t *taskWoken) {
+    if (config.de_pin >= 0) {
+        gpio_put(config.de_pin, 0);
+    }
+    transmitting = false;
+    tx_q->sendFromIsr(serial_io::BytesWritten(tx_length), taskWoken);
+}
+
+} // namespace vla
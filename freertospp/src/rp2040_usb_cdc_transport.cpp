@@ -0,0 +1,67 @@
+#include <hardware/sync.h>
+#include <pico/stdio_usb.h>
+#include <pico/time.h>
+#include <vla/rp2040_usb_cdc_transport.hpp>
+
+namespace vla {
+
+// used when the driver reports chars available, the poll is just a
+// safety net then.
+static constexpr auto usb_fallback_poll_period = PeriodUs{10000};
+// used when it does not.
+static constexpr auto usb_poll_period = PeriodUs{500};
+
+PeriodUs Rp2040UsbCdcTransport::poll_period = usb_poll_period;
+
+Rp2040UsbCdcTransport::Rp2040UsbCdcTransport() {
+    stdio_usb_init();
+}
+
+void Rp2040UsbCdcTransport::drain(RxSink &sink, void *,
+                                  BaseType_t *taskWoken) {
+    char chars[64];
+    auto count = stdio_usb.in_chars(chars, sizeof(chars));
+    while (count > 0) {
+        auto now = time_us_64();
+        for (int i = 0; i < count; ++i) {
+            sink.push(now, chars[i], taskWoken);
+        }
+        count = stdio_usb.in_chars(chars, sizeof(chars));
+    }
+}
+
+// called from the USB low priority IRQ, which the alarms that also
+// drain the driver can preempt.
+void Rp2040UsbCdcTransport::on_chars_available(void *data) {
+    BaseType_t taskWoken = pdFALSE;
+    auto status          = save_and_disable_interrupts();
+    drain(*static_cast<RxSink *>(data), nullptr, &taskWoken);
+    restore_interrupts(status);
+    portYIELD_FROM_ISR(taskWoken);
+}
+
+void Rp2040UsbCdcTransport::start(RxSink &sink) {
+    sink.set_drain(drain, nullptr);
+    if (stdio_usb.set_chars_available_callback) {
+        stdio_usb.set_chars_available_callback(on_chars_available, &sink);
+        poll_period = usb_fallback_poll_period;
+    }
+    auto handler = [](AlarmId, void *d) -> int64_t {
+        BaseType_t taskWoken = pdFALSE;
+        drain(*static_cast<RxSink *>(d), nullptr, &taskWoken);
+        portYIELD_FROM_ISR(taskWoken);
+        return -int64_t(poll_period.us);
+    };
+    set_alarm(poll_period, handler, &sink);
+}
+
+void Rp2040UsbCdcTransport::write(const uint8_t *data, uint16_t length,
+                                  ModbusDaemonQueue &q) {
+    stdio_usb.out_chars(reinterpret_cast<const char *>(data), length);
+    if (stdio_usb.out_flush) {
+        stdio_usb.out_flush();
+    }
+    q.send(serial_io::BytesWritten(length));
+}
+
+} // namespace vla
@@ -0,0 +1,118 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+#include <vector>
+
+#include <vla/crc16.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Throughput of the CRC16 variants per frame size. On x86 the time
+// stamp counter is used, elsewhere the cycles are estimated from
+// --mhz (default 1000), so use bytes/ns to compare across machines.
+//
+//   crc16_bench [--mhz n] [total_bytes_per_run]
+
+static uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// keeps the compiler from dropping the computation
+static volatile uint16_t sink;
+
+struct Result {
+    double bytes_per_ns;
+    double bytes_per_cycle;
+};
+
+template <size_t Slices>
+static Result run(const std::vector<uint8_t> &data, size_t frame_size,
+                  size_t total, double mhz) {
+    auto frames = total / frame_size;
+    Result best = {0, 0};
+    for (int repeat = 0; repeat < 5; ++repeat) {
+        auto t0 = ticks();
+        auto n0 = now_ns();
+        for (size_t i = 0; i < frames; ++i) {
+            auto frame = &data[(i * frame_size) % (data.size() - frame_size)];
+            sink       = vla::crc16::update<Slices>(vla::crc16::INIT, frame,
+                                              frame_size);
+        }
+        auto t1     = ticks();
+        auto n1     = now_ns();
+        auto bytes  = double(frames * frame_size);
+        auto ns     = double(n1 - n0);
+        auto cycles = t1 != t0 ? double(t1 - t0) : ns * mhz / 1000;
+        if (bytes / ns > best.bytes_per_ns) {
+            best = {bytes / ns, bytes / cycles};
+        }
+    }
+    return best;
+}
+
+template <size_t Slices> static bool check(const std::vector<uint8_t> &data) {
+    for (size_t length = 0; length < 64; ++length) {
+        for (size_t offset = 0; offset < 8; ++offset) {
+            if (vla::crc16::update<Slices>(vla::crc16::INIT, &data[offset],
+                                           length) !=
+                vla::crc16::compute(&data[offset], length)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    double mhz   = 1000;
+    size_t total = 16 * 1024 * 1024;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string_view(argv[i]) == "--mhz" && i + 1 < argc) {
+            mhz = atof(argv[++i]);
+        } else {
+            total = strtoul(argv[i], nullptr, 0);
+        }
+    }
+
+    std::vector<uint8_t> data(64 * 1024);
+    uint32_t seed = 0x12345678;
+    for (auto &b : data) {
+        seed = seed * 1664525 + 1013904223;
+        b    = seed >> 24;
+    }
+    if (!check<4>(data) || !check<8>(data)) {
+        printf("slicing variants disagree with the byte wise one\n");
+        return 1;
+    }
+
+    printf("table bytes: byte wise %zu, slicing-by-4 %zu, slicing-by-8 %zu\n",
+           sizeof(vla::crc16::Tables<1>), sizeof(vla::crc16::Tables<4>),
+           sizeof(vla::crc16::Tables<8>));
+    printf("%6s %10s %12s %12s\n", "frame", "variant", "bytes/cycle",
+           "bytes/ns");
+    for (size_t frame_size : {8, 16, 64, 128, 256, 4096}) {
+        Result results[] = {run<1>(data, frame_size, total, mhz),
+                            run<4>(data, frame_size, total, mhz),
+                            run<8>(data, frame_size, total, mhz)};
+        const char *names[] = {"byte", "slice4", "slice8"};
+        for (int i = 0; i < 3; ++i) {
+            printf("%6zu %10s %12.3f %12.3f\n", frame_size, names[i],
+                   results[i].bytes_per_cycle, results[i].bytes_per_ns);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,228 @@
+#include <FreeRTOS.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <task.h>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+#include <vla/coil_bank.hpp>
+#include <vla/crc16.h>
+#include <vla/modbus_daemon.hpp>
+#include <vla/pdu_handler_base.hpp>
+#include <vla/posix_fd_transport.hpp>
+#include <vla/register_map.hpp>
+#include <vla/task.hpp>
+#include <vla/unit_dispatcher.hpp>
+
+// Host build of the RTU slave, as units 1 and 2. Usage:
+//
+//   rtu_host pty          serve on a new pty, its path is printed
+//   rtu_host bench [n]    time n requests over a socketpair
+
+static uint16_t registers[0x7d];
+static constexpr vla::RegisterRange host_ranges[] = {
+    vla::array_registers(0, registers),
+};
+using HostRegisters = vla::RegisterMap<host_ranges>;
+
+class HostHandler : public vla::PduHandlerBase<HostHandler> {
+    vla::CoilBank<0x7b0> coils;
+
+  public:
+    bool is_read_coils_supported() {
+        return true;
+    }
+    bool is_write_coils_supported() {
+        return true;
+    }
+    bool is_read_coils_valid_data_address(uint16_t address,
+                                          uint16_t bit_count) {
+        return coils.is_valid_data_address(address, bit_count);
+    }
+    bool is_write_coils_valid_data_address(uint16_t address,
+                                           uint16_t bit_count) {
+        return coils.is_valid_data_address(address, bit_count);
+    }
+    bool execute_read_coils(uint16_t address, uint16_t bit_count,
+                            uint8_t *bytes) {
+        coils.read(address, bit_count, bytes);
+        return true;
+    }
+    bool execute_write_coils(uint16_t address, const uint8_t *bits,
+                             uint16_t bit_count) {
+        coils.write(address, bits, bit_count);
+        return true;
+    }
+    bool execute_write_single_coil(uint16_t address, bool value) {
+        coils.set(address, value);
+        return true;
+    }
+    bool is_read_registers_supported() {
+        return true;
+    }
+    bool is_write_registers_supported() {
+        return true;
+    }
+    bool is_read_registers_valid_data_address(uint16_t address,
+                                              uint16_t register_count) {
+        return HostRegisters::is_readable(address, register_count);
+    }
+    bool is_write_registers_valid_data_address(uint16_t address,
+                                               uint16_t register_count) {
+        return HostRegisters::is_writable(address, register_count);
+    }
+    bool execute_read_registers(uint16_t address, uint16_t register_count,
+                                vla::RegisterWords words) {
+        return HostRegisters::read(address, register_count, words);
+    }
+    bool execute_write_registers(uint16_t address,
+                                 vla::ConstRegisterWords words,
+                                 uint8_t register_count) {
+        return HostRegisters::write(address, register_count, words);
+    }
+    HostHandler(vla::RtuAddress addr)
+        : vla::PduHandlerBase<HostHandler>(addr) {
+    }
+};
+
+static auto host_handler = HostHandler(vla::RtuAddress(0x01));
+// unit 2 has coils of its own, it shares the holding registers
+static auto second_handler = HostHandler(vla::RtuAddress(0x02));
+static auto units = vla::UnitDispatcher<vla::Unit<0x01, host_handler>,
+                                        vla::Unit<0x02, second_handler>>();
+
+static constexpr auto timing = vla::RtuTiming::for_line(115200);
+
+static void serve(int fd) {
+    static vla::PosixFdTransport transport(fd);
+    static vla::ModbusDaemonContext context;
+    vla::modbus_daemon(context, transport, units, vla::RxMode::FRAMES, timing);
+}
+
+static uint64_t elapsed_us(const timespec &a, const timespec &b) {
+    return uint64_t(b.tv_sec - a.tv_sec) * 1000000 +
+           (b.tv_nsec - a.tv_nsec) / 1000;
+}
+
+struct BenchConfig {
+    int fd;
+    int count;
+};
+
+// the master side runs in a plain thread, it must not use the FreeRTOS
+// API.
+static void *bench_master(void *data) {
+    auto config = static_cast<BenchConfig *>(data);
+    // read 10 holding registers from 0
+    uint8_t request[8] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x0a};
+    auto crc           = vla_modbus_crc16(request, 6);
+    request[6]         = crc;
+    request[7]         = crc >> 8;
+
+    const size_t reply_length = 3 + 2 * 10 + 2;
+    std::vector<uint64_t> latencies;
+    int timeouts = 0;
+    for (int i = 0; i < config->count; ++i) {
+        timespec start, end;
+        uint8_t reply[vla::PDU_MAX];
+        size_t received = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        write(config->fd, request, sizeof(request));
+        while (received < reply_length) {
+            pollfd pfd = {config->fd, POLLIN, 0};
+            if (poll(&pfd, 1, 1000) <= 0) {
+                ++timeouts;
+                break;
+            }
+            auto count = read(config->fd, reply + received,
+                              sizeof(reply) - received);
+            if (count <= 0) {
+                break;
+            }
+            received += count;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (received == reply_length) {
+            latencies.push_back(elapsed_us(start, end));
+        }
+        // let the line go idle before the next request
+        usleep(2 * timing.inter_frame_delay.us);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    if (latencies.empty()) {
+        printf("no replies, %d timeouts\n", timeouts);
+        exit(1);
+    }
+    uint64_t total = 0;
+    for (auto l : latencies) {
+        total += l;
+    }
+    printf("requests %d replies %zu timeouts %d\n", config->count,
+           latencies.size(), timeouts);
+    printf("round trip us: min %llu avg %llu p99 %llu max %llu\n",
+           (unsigned long long)latencies.front(),
+           (unsigned long long)(total / latencies.size()),
+           (unsigned long long)latencies[latencies.size() * 99 / 100],
+           (unsigned long long)latencies.back());
+    exit(0);
+}
+
+static int open_pty() {
+    auto fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) || unlockpt(fd)) {
+        perror("pty");
+        exit(1);
+    }
+    termios tio;
+    tcgetattr(fd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(fd, TCSANOW, &tio);
+    printf("serving on %s\n", ptsname(fd));
+    fflush(stdout);
+    return fd;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s pty | bench [count]\n", argv[0]);
+        return 1;
+    }
+    int fd;
+    if (!strcmp(argv[1], "pty")) {
+        fd = open_pty();
+    } else {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+            perror("socketpair");
+            return 1;
+        }
+        fd = fds[0];
+        static BenchConfig config;
+        config.fd    = fds[1];
+        config.count = argc > 2 ? atoi(argv[2]) : 1000;
+        // the tick of the POSIX port is a signal, keep it away from
+        // the master thread.
+        sigset_t all, previous;
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &previous);
+        pthread_t master;
+        pthread_create(&master, nullptr, bench_master, &config);
+        pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    }
+
+    auto modbus_task =
+        vla::Task(std::bind(serve, fd), "Modbus Task", 0x4000);
+    configASSERT(modbus_task);
+
+    vTaskStartScheduler();
+    return 0;
+}
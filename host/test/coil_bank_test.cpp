@@ -0,0 +1,149 @@
+#include <cstdint>
+
+#include <vla/coil_bank.hpp>
+#include <vla/pdu_handler_base.hpp>
+
+#include "modbus_test.hpp"
+
+// Coils and discrete inputs served from CoilBanks, with blocks that
+// start and end anywhere within the 32 bit words.
+
+using vla::RtuExceptionCode;
+using vla::test::Bytes;
+using vla::test::check_exception;
+using vla::test::check_reply;
+
+class Handler : public vla::PduHandlerBase<Handler> {
+  public:
+    vla::CoilBank<100> coils;
+    vla::CoilBank<40> inputs;
+
+    bool is_read_coils_supported() {
+        return true;
+    }
+    bool is_write_coils_supported() {
+        return true;
+    }
+    bool is_read_discrete_inputs_supported() {
+        return true;
+    }
+    bool is_read_coils_valid_data_address(uint16_t address,
+                                          uint16_t bit_count) {
+        return coils.is_valid_data_address(address, bit_count);
+    }
+    bool is_write_coils_valid_data_address(uint16_t address,
+                                           uint16_t bit_count) {
+        return coils.is_valid_data_address(address, bit_count);
+    }
+    bool is_read_discrete_inputs_valid_data_address(uint16_t address,
+                                                    uint16_t bit_count) {
+        return inputs.is_valid_data_address(address, bit_count);
+    }
+    bool execute_read_coils(uint16_t address, uint16_t bit_count,
+                            uint8_t *bytes) {
+        coils.read(address, bit_count, bytes);
+        return true;
+    }
+    bool execute_write_coils(uint16_t address, const uint8_t *bits,
+                             uint16_t bit_count) {
+        coils.write(address, bits, bit_count);
+        return true;
+    }
+    bool execute_write_single_coil(uint16_t address, bool value) {
+        coils.set(address, value);
+        return true;
+    }
+    bool execute_read_discrete_inputs(uint16_t address, uint16_t bit_count,
+                                      uint8_t *bytes) {
+        inputs.read(address, bit_count, bytes);
+        return true;
+    }
+    Handler() : vla::PduHandlerBase<Handler>(vla::RtuAddress(1)) {
+    }
+};
+
+static Handler handler;
+
+// the examples of the specification, coils 20 to 38 are addressed 19
+static void test_spec_examples() {
+    const uint8_t states[] = {0xcd, 0x6b, 0x05};
+    handler.coils.write(19, states, 19);
+    check_reply(handler, {1, 0x01, 0x00, 0x13, 0x00, 0x13},
+                {1, 0x01, 0x03, 0xcd, 0x6b, 0x05});
+
+    const uint8_t cleared[] = {0, 0};
+    handler.coils.write(19, cleared, 10);
+    check_reply(handler, {1, 0x0f, 0x00, 0x13, 0x00, 0x0a, 0x02, 0xcd, 0x01},
+                {1, 0x0f, 0x00, 0x13, 0x00, 0x0a});
+    const bool expected[] = {1, 0, 1, 1, 0, 0, 1, 1, 1, 0};
+    for (uint16_t i = 0; i < 10; ++i) {
+        CHECK(handler.coils.get(19 + i) == expected[i]);
+    }
+}
+
+// 40 coils from 30 cover the end of word 0, all of word 1 and the
+// start of word 2.
+static void test_across_words() {
+    handler.coils.set(29, true);
+    handler.coils.set(70, true);
+    Bytes request = {1, 0x0f, 0x00, 30, 0x00, 40, 5};
+    Bytes pattern = {0x5a, 0xff, 0x00, 0x81, 0xc3};
+    request.insert(request.end(), pattern.begin(), pattern.end());
+    check_reply(handler, request, {1, 0x0f, 0x00, 30, 0x00, 40});
+    for (uint16_t i = 0; i < 40; ++i) {
+        CHECK(handler.coils.get(30 + i) == bool(pattern[i / 8] >> i % 8 & 1));
+    }
+    Bytes reply = {1, 0x01, 5};
+    reply.insert(reply.end(), pattern.begin(), pattern.end());
+    check_reply(handler, {1, 0x01, 0x00, 30, 0x00, 40}, reply);
+    // shifted by 4, the unused bits of the last byte are cleared
+    check_reply(handler, {1, 0x01, 0x00, 34, 0x00, 12},
+                {1, 0x01, 2, 0xf5, 0x0f});
+    // the neighbours are left alone
+    CHECK(handler.coils.get(29));
+    CHECK(handler.coils.get(70));
+}
+
+static void test_single_coil() {
+    check_reply(handler, {1, 0x05, 0x00, 0x63, 0xff, 0x00},
+                {1, 0x05, 0x00, 0x63, 0xff, 0x00});
+    CHECK(handler.coils.get(99));
+    check_reply(handler, {1, 0x05, 0x00, 0x63, 0x00, 0x00},
+                {1, 0x05, 0x00, 0x63, 0x00, 0x00});
+    CHECK(!handler.coils.get(99));
+    check_exception(handler, {1, 0x05, 0x00, 0x63, 0x12, 0x34},
+                    RtuExceptionCode::ILLEGAL_DATA_VALUE);
+    check_exception(handler, {1, 0x05, 0x00, 0x64, 0xff, 0x00},
+                    RtuExceptionCode::ILLEGAL_DATA_ADDRESS);
+}
+
+static void test_discrete_inputs() {
+    handler.inputs.set(0, true);
+    handler.inputs.set(33, true);
+    handler.inputs.set(39, true);
+    check_reply(handler, {1, 0x02, 0x00, 0x00, 0x00, 40},
+                {1, 0x02, 5, 0x01, 0x00, 0x00, 0x00, 0x82});
+    check_reply(handler, {1, 0x02, 0x00, 33, 0x00, 7},
+                {1, 0x02, 1, 0x41});
+    check_exception(handler, {1, 0x02, 0x00, 33, 0x00, 8},
+                    RtuExceptionCode::ILLEGAL_DATA_ADDRESS);
+}
+
+static void test_bad_requests() {
+    check_exception(handler, {1, 0x01, 0x00, 0x60, 0x00, 0x05},
+                    RtuExceptionCode::ILLEGAL_DATA_ADDRESS);
+    check_exception(handler, {1, 0x01, 0x00, 0x00, 0x00, 0x00},
+                    RtuExceptionCode::ILLEGAL_DATA_VALUE);
+    // the byte count does not match the coil count
+    check_exception(handler, {1, 0x0f, 0x00, 0x00, 0x00, 0x09, 0x01, 0xff},
+                    RtuExceptionCode::ILLEGAL_DATA_VALUE);
+}
+
+int main() {
+    test_spec_examples();
+    test_across_words();
+    test_single_coil();
+    test_discrete_inputs();
+    test_bad_requests();
+    return vla::test::result();
+}
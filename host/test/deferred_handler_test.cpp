@@ -0,0 +1,218 @@
+#include <FreeRTOS.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <task.h>
+#include <vector>
+
+#include <vla/deferred_handler.hpp>
+#include <vla/modbus_daemon.hpp>
+#include <vla/pdu_handler_base.hpp>
+#include <vla/task.hpp>
+
+#include "modbus_test.hpp"
+
+// A DeferredHandler served by the daemon FSM. The test task is the
+// daemon, it feeds the FSM from its queue, and it stands in for the
+// worker too: it runs the deferred jobs when it chooses to, so that
+// they finish before or after their budget.
+
+using vla::test::Bytes;
+
+// holding registers 0 to 3, only the writes are deferred
+class Handler : public vla::PduHandlerBase<Handler> {
+  public:
+    uint16_t registers[4] = {};
+
+    bool is_read_registers_supported() {
+        return true;
+    }
+    bool is_write_registers_supported() {
+        return true;
+    }
+    bool is_read_registers_valid_data_address(uint16_t address,
+                                              uint16_t register_count) {
+        return address + register_count <= 4;
+    }
+    bool is_write_registers_valid_data_address(uint16_t address,
+                                               uint16_t register_count) {
+        return address + register_count <= 4;
+    }
+    bool execute_read_single_register(uint16_t address, uint16_t *w) {
+        *w = registers[address];
+        return true;
+    }
+    bool execute_write_single_register(uint16_t address, uint16_t v) {
+        registers[address] = v;
+        return true;
+    }
+    Handler() : vla::PduHandlerBase<Handler>(vla::RtuAddress(1)) {
+    }
+};
+
+// keeps the frames written and reports them out right away
+class TestTransport {
+  public:
+    std::vector<Bytes> written;
+
+    void start(vla::RxSink &) {
+    }
+    void write(const uint8_t *data, uint16_t length,
+               vla::ModbusDaemonQueue &q) {
+        written.emplace_back(data, data + length);
+        q.send(vla::serial_io::BytesWritten(length), 0);
+    }
+};
+
+using Deferred = vla::DeferredHandler<Handler>;
+
+static constexpr auto budget = vla::PeriodUs(20000);
+
+static Handler handler;
+static TestTransport transport;
+// created by the test task, once FreeRTOS runs
+static Deferred *deferred;
+static vla::ModbusDaemonContext *context;
+static vla::ModbusDaemonFsm<Deferred> *fsm;
+
+// feed the daemon until it has been idle for ms
+static void pump(TickType_t ms) {
+    vla::ModbusDaemonMessage msg;
+    while (context->q.receive(msg, pdMS_TO_TICKS(ms))) {
+        fsm->on_message(msg);
+    }
+}
+
+// hand the frame over as the RX side does in RxMode::FRAMES, long
+// enough ago for the reply to go out right away.
+static void receive(Bytes frame) {
+    auto crc = vla_modbus_crc16(frame.data(), frame.size());
+    frame.push_back(crc);
+    frame.push_back(crc >> 8);
+    auto buffer = context->pool.acquire();
+    CHECK(buffer);
+    if (!buffer) {
+        return;
+    }
+    std::memcpy(buffer, frame.data(), frame.size());
+    auto last = vla::now_us() - 10000;
+    context->q.send(vla::FrameReceived{buffer, uint16_t(frame.size()), 0,
+                                       last - 1000, last},
+                    0);
+    pump(0);
+}
+
+// checks the frames written since the last call, without their CRC
+static void check_replies(const std::vector<Bytes> &expected,
+                          int line = __builtin_LINE()) {
+    std::vector<Bytes> frames;
+    for (auto &frame : transport.written) {
+        CHECK(frame.size() >= 4 &&
+              !vla_modbus_crc16(frame.data(), frame.size()));
+        frames.emplace_back(frame.begin(), frame.end() - 2);
+    }
+    transport.written.clear();
+    if (frames != expected) {
+        std::printf("line %d: wrong replies\n", line);
+        for (auto &frame : expected) {
+            vla::test::print_bytes("expected", frame);
+        }
+        for (auto &frame : frames) {
+            vla::test::print_bytes("got     ", frame);
+        }
+        ++vla::test::failures;
+    }
+}
+
+static void test_immediate() {
+    handler.registers[0] = 0x1234;
+    receive({1, 0x03, 0x00, 0x00, 0x00, 0x01});
+    pump(10);
+    check_replies({{1, 0x03, 0x02, 0x12, 0x34}});
+}
+
+static void test_done_within_budget() {
+    const Bytes write = {1, 0x06, 0x00, 0x01, 0xab, 0xcd};
+    receive(write);
+    check_replies({});
+    CHECK(handler.registers[1] == 0);
+    CHECK(deferred->work_once(0));
+    pump(2 * budget.us / 1000);
+    check_replies({write});
+    CHECK(handler.registers[1] == 0xabcd);
+}
+
+static void test_acknowledge_and_poll() {
+    const Bytes write = {1, 0x06, 0x00, 0x02, 0x00, 0x07};
+    receive(write);
+    pump(2 * budget.us / 1000);
+    check_replies({{1, 0x86, 0x05}});
+    // the job is still pending, polls and other requests are refused
+    receive(write);
+    receive({1, 0x03, 0x00, 0x00, 0x00, 0x01});
+    pump(10);
+    check_replies({{1, 0x86, 0x06}, {1, 0x83, 0x06}});
+    CHECK(deferred->work_once(0));
+    pump(10);
+    check_replies({});
+    CHECK(handler.registers[2] == 7);
+    receive(write);
+    pump(10);
+    check_replies({write});
+}
+
+// a frame received while waiting for the worker means that the master
+// has moved on, the deferred request is not answered at all.
+static void test_master_moves_on() {
+    const Bytes write = {1, 0x06, 0x00, 0x02, 0x00, 0x08};
+    receive(write);
+    receive({1, 0x03, 0x00, 0x02, 0x00, 0x01});
+    pump(2 * budget.us / 1000);
+    check_replies({{1, 0x83, 0x06}});
+    CHECK(deferred->work_once(0));
+    pump(10);
+    check_replies({});
+    receive({1, 0x03, 0x00, 0x02, 0x00, 0x01});
+    pump(10);
+    check_replies({{1, 0x03, 0x02, 0x00, 0x08}});
+}
+
+static void test_broadcast() {
+    receive({0, 0x06, 0x00, 0x03, 0x00, 0x09});
+    CHECK(deferred->work_once(0));
+    pump(2 * budget.us / 1000);
+    check_replies({});
+    CHECK(handler.registers[3] == 9);
+}
+
+static void run_tests() {
+    static Deferred deferred_handler(
+        handler, vla::RtuAddress(1), budget,
+        vla::RtuFunctionCode::WRITE_SINGLE_REGISTER);
+    static vla::ModbusDaemonContext daemon_context;
+    static vla::ModbusDaemonFsm<Deferred> daemon_fsm(
+        daemon_context.q, daemon_context.pool,
+        vla::SerialTransport(transport), deferred_handler,
+        vla::default_rtu_timing, daemon_context.stats);
+    deferred = &deferred_handler;
+    context  = &daemon_context;
+    fsm      = &daemon_fsm;
+    pump(10);
+    test_immediate();
+    test_done_within_budget();
+    test_acknowledge_and_poll();
+    test_master_moves_on();
+    test_broadcast();
+    // every buffer is back in the pool
+    for (int i = 0; i < MODBUS_FRAME_BUFFERS; ++i) {
+        CHECK(context->pool.acquire());
+    }
+    std::exit(vla::test::result());
+}
+
+int main() {
+    auto test_task = vla::Task([] { run_tests(); }, "Test Task", 0x4000);
+    vTaskStartScheduler();
+    return 1;
+}
@@ -0,0 +1,125 @@
+#include <cstdint>
+#include <string_view>
+
+#include <vla/device_identification.hpp>
+#include <vla/pdu_handler_base.hpp>
+
+#include "modbus_test.hpp"
+
+// Read Device Identification (0x2b / 0x0e) from a DeviceIdentification
+// table, with extended objects long enough to need two replies.
+
+using vla::DeviceObjectId;
+using vla::RtuExceptionCode;
+using vla::test::Bytes;
+using vla::test::check_exception;
+using vla::test::check_reply;
+
+static constexpr std::string_view digits =
+    "0123456789012345678901234567890123456789012345678901234567890123456789"
+    "012345678901234567890123456789";
+
+static constexpr vla::DeviceObject objects[] = {
+    {DeviceObjectId::VENDOR_NAME, "VLA"},
+    {DeviceObjectId::PRODUCT_CODE, "RTU"},
+    {DeviceObjectId::MAJOR_MINOR_REVISION, "1.0"},
+    {DeviceObjectId::PRODUCT_NAME, digits},
+    {DeviceObjectId(0x80), digits},
+    {DeviceObjectId(0x81), digits},
+    {DeviceObjectId(0x90), "z"},
+};
+using Identification = vla::DeviceIdentification<objects>;
+
+class Handler : public vla::PduHandlerBase<Handler> {
+  public:
+    const vla::DeviceIdentificationTable *device_identification() {
+        return &Identification::table;
+    }
+    Handler() : vla::PduHandlerBase<Handler>(vla::RtuAddress(1)) {
+    }
+};
+
+// no table, the function is not supported
+class NoIdentificationHandler
+    : public vla::PduHandlerBase<NoIdentificationHandler> {
+  public:
+    NoIdentificationHandler()
+        : vla::PduHandlerBase<NoIdentificationHandler>(vla::RtuAddress(1)) {
+    }
+};
+
+static Handler handler;
+static NoIdentificationHandler no_identification;
+
+// the header of a reply: conformity level 0x83, extended and
+// individual access
+static Bytes header(uint8_t code, uint8_t more, uint8_t next, uint8_t count) {
+    return {1, 0x2b, 0x0e, code, 0x83, more, next, count};
+}
+
+static void append(Bytes &reply, uint8_t id, std::string_view value) {
+    reply.push_back(id);
+    reply.push_back(value.size());
+    reply.insert(reply.end(), value.begin(), value.end());
+}
+
+static void append_basic(Bytes &reply) {
+    append(reply, 0x00, "VLA");
+    append(reply, 0x01, "RTU");
+    append(reply, 0x02, "1.0");
+}
+
+static void test_categories() {
+    Bytes basic = header(1, 0x00, 0x00, 3);
+    append_basic(basic);
+    check_reply(handler, {1, 0x2b, 0x0e, 0x01, 0x00}, basic);
+
+    Bytes regular = header(2, 0x00, 0x00, 4);
+    append_basic(regular);
+    append(regular, 0x04, digits);
+    check_reply(handler, {1, 0x2b, 0x0e, 0x02, 0x00}, regular);
+
+    // an object id outside the category starts from its first object
+    basic[3] = 1;
+    check_reply(handler, {1, 0x2b, 0x0e, 0x01, 0x80}, basic);
+}
+
+// the three objects of 100 chars do not fit in one reply
+static void test_continuation() {
+    Bytes first = header(3, 0xff, 0x81, 5);
+    append_basic(first);
+    append(first, 0x04, digits);
+    append(first, 0x80, digits);
+    check_reply(handler, {1, 0x2b, 0x0e, 0x03, 0x00}, first);
+
+    Bytes rest = header(3, 0x00, 0x00, 2);
+    append(rest, 0x81, digits);
+    append(rest, 0x90, "z");
+    check_reply(handler, {1, 0x2b, 0x0e, 0x03, 0x81}, rest);
+}
+
+static void test_individual_access() {
+    Bytes reply = header(4, 0x00, 0x00, 1);
+    append(reply, 0x90, "z");
+    check_reply(handler, {1, 0x2b, 0x0e, 0x04, 0x90}, reply);
+    check_exception(handler, {1, 0x2b, 0x0e, 0x04, 0x05},
+                    RtuExceptionCode::ILLEGAL_DATA_ADDRESS);
+}
+
+static void test_bad_requests() {
+    check_exception(handler, {1, 0x2b, 0x0e, 0x05, 0x00},
+                    RtuExceptionCode::ILLEGAL_DATA_VALUE);
+    // another MEI type
+    check_exception(handler, {1, 0x2b, 0x0d, 0x01, 0x00},
+                    RtuExceptionCode::ILLEGAL_FUNCTION);
+    check_exception(no_identification, {1, 0x2b, 0x0e, 0x01, 0x00},
+                    RtuExceptionCode::ILLEGAL_FUNCTION);
+}
+
+int main() {
+    test_categories();
+    test_continuation();
+    test_individual_access();
+    test_bad_requests();
+    return vla::test::result();
+}
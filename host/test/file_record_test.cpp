@@ -0,0 +1,156 @@
+#include <cstdint>
+
+#include <vla/file_record_store.hpp>
+#include <vla/pdu_handler_base.hpp>
+
+#include "modbus_test.hpp"
+
+// Read/Write File Record (0x14/0x15) served from a FileRecordStore
+// with a writable file, a read only one and a callback file.
+
+using vla::RtuExceptionCode;
+using vla::test::Bytes;
+using vla::test::check_exception;
+using vla::test::check_reply;
+
+static uint16_t file3[200];
+static uint16_t file4[10];
+static const uint16_t serial_number[2] = {0x0001, 0x0002};
+
+// record i holds 0x9000 + i
+static bool read_computed(uint16_t record, uint16_t record_count,
+                          vla::RegisterWords words) {
+    for (uint16_t i = 0; i < record_count; ++i) {
+        words[i] = 0x9000 + record + i;
+    }
+    return true;
+}
+
+static constexpr vla::RecordFile files[] = {
+    vla::record_file(3, file3),
+    vla::record_file(4, file4),
+    vla::record_file(7, serial_number),
+    vla::callback_file(9, 1000, read_computed),
+};
+using Files = vla::FileRecordStore<files>;
+
+class Handler : public vla::PduHandlerBase<Handler> {
+  public:
+    bool is_read_file_record_supported() {
+        return true;
+    }
+    bool is_write_file_record_supported() {
+        return true;
+    }
+    bool is_read_file_record_valid_data_address(uint16_t file,
+                                                uint16_t record,
+                                                uint16_t record_count) {
+        return Files::is_readable(file, record, record_count);
+    }
+    bool is_write_file_record_valid_data_address(uint16_t file,
+                                                 uint16_t record,
+                                                 uint16_t record_count) {
+        return Files::is_writable(file, record, record_count);
+    }
+    bool execute_read_file_record(uint16_t file, uint16_t record,
+                                  uint16_t record_count,
+                                  vla::RegisterWords words) {
+        return Files::read(file, record, record_count, words);
+    }
+    bool execute_write_file_record(uint16_t file, uint16_t record,
+                                   uint16_t record_count,
+                                   vla::ConstRegisterWords words) {
+        return Files::write(file, record, record_count, words);
+    }
+    Handler() : vla::PduHandlerBase<Handler>(vla::RtuAddress(1)) {
+    }
+};
+
+static Handler handler;
+
+static void test_spec_examples() {
+    file4[1]  = 0x0dfe;
+    file4[2]  = 0x0020;
+    file3[9]  = 0x33cd;
+    file3[10] = 0x0040;
+    check_reply(handler,
+                {1, 0x14, 0x0e, 0x06, 0x00, 0x04, 0x00, 0x01, 0x00, 0x02,
+                 0x06, 0x00, 0x03, 0x00, 0x09, 0x00, 0x02},
+                {1, 0x14, 0x0c, 0x05, 0x06, 0x0d, 0xfe, 0x00, 0x20, 0x05,
+                 0x06, 0x33, 0xcd, 0x00, 0x40});
+
+    const Bytes write = {1,    0x15, 0x0d, 0x06, 0x00, 0x04, 0x00, 0x07,
+                         0x00, 0x03, 0x06, 0xaf, 0x04, 0xbe, 0x10, 0x0d};
+    check_reply(handler, write, write);
+    CHECK(file4[7] == 0x06af);
+    CHECK(file4[8] == 0x04be);
+    CHECK(file4[9] == 0x100d);
+}
+
+static void test_several_writes() {
+    const Bytes write = {1,    0x15, 0x12, 0x06, 0x00, 0x03, 0x00,
+                         0x00, 0x00, 0x01, 0xaa, 0xbb, 0x06, 0x00,
+                         0x03, 0x00, 0xc7, 0x00, 0x01, 0xcc, 0xdd};
+    check_reply(handler, write, write);
+    CHECK(file3[0] == 0xaabb);
+    CHECK(file3[199] == 0xccdd);
+}
+
+static void test_read_only_files() {
+    check_reply(handler, {1, 0x14, 0x07, 0x06, 0x00, 0x07, 0x00, 0x00, 0x00,
+                          0x02},
+                {1, 0x14, 0x06, 0x05, 0x06, 0x00, 0x01, 0x00, 0x02});
+    check_reply(handler, {1, 0x14, 0x07, 0x06, 0x00, 0x09, 0x03, 0xe6, 0x00,
+                          0x02},
+                {1, 0x14, 0x06, 0x05, 0x06, 0x93, 0xe6, 0x93, 0xe7});
+    check_exception(handler,
+                    {1, 0x15, 0x09, 0x06, 0x00, 0x07, 0x00, 0x00, 0x00, 0x01,
+                     0x00, 0x09},
+                    RtuExceptionCode::ILLEGAL_DATA_ADDRESS);
+    check_exception(handler,
+                    {1, 0x15, 0x09, 0x06, 0x00, 0x09, 0x00, 0x00, 0x00, 0x01,
+                     0x00, 0x09},
+                    RtuExceptionCode::ILLEGAL_DATA_ADDRESS);
+    CHECK(serial_number[0] == 0x0001);
+}
+
+static void test_bad_requests() {
+    // reference type 5
+    check_exception(handler,
+                    {1, 0x14, 0x07, 0x05, 0x00, 0x04, 0x00, 0x00, 0x00, 0x01},
+                    RtuExceptionCode::ILLEGAL_DATA_ADDRESS);
+    // past the end of the file, or no such file
+    check_exception(handler,
+                    {1, 0x14, 0x07, 0x06, 0x00, 0x04, 0x00, 0x09, 0x00, 0x02},
+                    RtuExceptionCode::ILLEGAL_DATA_ADDRESS);
+    check_exception(handler,
+                    {1, 0x14, 0x07, 0x06, 0x00, 0x05, 0x00, 0x00, 0x00, 0x01},
+                    RtuExceptionCode::ILLEGAL_DATA_ADDRESS);
+    // no record at all, or a byte count that is not made of
+    // sub-requests
+    check_exception(handler,
+                    {1, 0x14, 0x07, 0x06, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00},
+                    RtuExceptionCode::ILLEGAL_DATA_VALUE);
+    check_exception(handler,
+                    {1, 0x14, 0x08, 0x06, 0x00, 0x04, 0x00, 0x00, 0x00, 0x01,
+                     0x00},
+                    RtuExceptionCode::ILLEGAL_DATA_VALUE);
+    // the reply would not fit in a PDU
+    check_exception(handler,
+                    {1, 0x14, 0x07, 0x06, 0x00, 0x03, 0x00, 0x00, 0x00, 0x7a},
+                    RtuExceptionCode::ILLEGAL_DATA_VALUE);
+    // two records announced, one sent
+    check_exception(handler,
+                    {1, 0x15, 0x0b, 0x06, 0x00, 0x04, 0x00, 0x00, 0x00, 0x02,
+                     0x00, 0x01, 0x00},
+                    RtuExceptionCode::ILLEGAL_DATA_VALUE);
+    CHECK(file4[0] == 0);
+}
+
+int main() {
+    test_spec_examples();
+    test_several_writes();
+    test_read_only_files();
+    test_bad_requests();
+    return vla::test::result();
+}
@@ -0,0 +1,92 @@
+#ifndef VLA_MODBUS_TEST_HPP
+#define VLA_MODBUS_TEST_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <vla/crc16.h>
+#include <vla/rtu_message.hpp>
+
+// Helpers shared by the host tests. Each test is a plain executable
+// that sends request frames to a handler and checks the replies, it
+// exits with 1 if any check failed. Frames are written without their
+// CRC, request adds it and checks and strips the one of the reply.
+
+namespace vla::test {
+
+using Bytes = std::vector<uint8_t>;
+
+inline int failures = 0;
+
+inline void print_bytes(const char *label, const Bytes &bytes) {
+    std::printf("  %s:", label);
+    for (auto b : bytes) {
+        std::printf(" %02x", b);
+    }
+    std::printf("\n");
+}
+
+inline void check(bool ok, const char *what, int line) {
+    if (!ok) {
+        std::printf("line %d: check failed: %s\n", line, what);
+        ++failures;
+    }
+}
+
+// the reply is handled in place, as the daemon does. Empty if there is
+// none.
+template <typename Handler> Bytes request(Handler &handler, Bytes frame) {
+    uint8_t buffer[PDU_MAX];
+    auto crc = vla_modbus_crc16(frame.data(), frame.size());
+    frame.push_back(crc);
+    frame.push_back(crc >> 8);
+    std::memcpy(buffer, frame.data(), frame.size());
+    auto msg = RtuMessage(buffer, frame.size());
+    handler(msg, msg);
+    if (msg.length == 0) {
+        return {};
+    }
+    if (msg.length < 4 || msg.length > PDU_MAX ||
+        vla_modbus_crc16(buffer, msg.length) != 0) {
+        std::printf("reply with a bad length or CRC\n");
+        ++failures;
+        return {};
+    }
+    return Bytes(buffer, buffer + msg.length - 2);
+}
+
+// the checks report the line they are called from
+template <typename Handler>
+void check_reply(Handler &handler, const Bytes &frame, const Bytes &expected,
+                 int line = __builtin_LINE()) {
+    auto reply = request(handler, frame);
+    if (reply != expected) {
+        std::printf("line %d: wrong reply\n", line);
+        print_bytes("request ", frame);
+        print_bytes("expected", expected);
+        print_bytes("got     ", reply);
+        ++failures;
+    }
+}
+
+template <typename Handler>
+void check_exception(Handler &handler, const Bytes &frame,
+                     RtuExceptionCode code, int line = __builtin_LINE()) {
+    auto function = uint8_t(frame[1] | 0x80);
+    check_reply(handler, frame, {frame[0], function, uint8_t(code)}, line);
+}
+
+inline int result() {
+    if (failures) {
+        std::printf("%d checks failed\n", failures);
+    }
+    return failures ? 1 : 0;
+}
+
+} // namespace vla::test
+
+#define CHECK(x) vla::test::check((x), #x, __LINE__)
+
+#endif // VLA_MODBUS_TEST_HPP
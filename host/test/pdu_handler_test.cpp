@@ -0,0 +1,155 @@
+#include <cstdint>
+
+#include <vla/pdu_handler_base.hpp>
+
+#include "modbus_test.hpp"
+
+// Dispatch of PduHandlerBase: Mask Write Register (0x16) and Read/Write
+// Multiple Registers (0x17) against the examples of the specification,
+// addressing and the function codes selected with SUPPORTED_FUNCTIONS.
+
+using vla::RtuExceptionCode;
+using vla::RtuFunctionCode;
+using vla::test::check_exception;
+using vla::test::check_reply;
+
+// every function the base class serves
+class Handler : public vla::PduHandlerBase<Handler> {
+  public:
+    uint16_t registers[20] = {};
+
+    bool is_read_registers_supported() {
+        return true;
+    }
+    bool is_write_registers_supported() {
+        return true;
+    }
+    bool is_read_registers_valid_data_address(uint16_t address,
+                                              uint16_t register_count) {
+        return address + register_count <= 20;
+    }
+    bool is_write_registers_valid_data_address(uint16_t address,
+                                               uint16_t register_count) {
+        return address + register_count <= 20;
+    }
+    bool execute_read_single_register(uint16_t address, uint16_t *w) {
+        *w = registers[address];
+        return true;
+    }
+    bool execute_write_single_register(uint16_t address, uint16_t v) {
+        registers[address] = v;
+        return true;
+    }
+    Handler() : vla::PduHandlerBase<Handler>(vla::RtuAddress(1)) {
+    }
+};
+
+// the same hooks, with only two function codes compiled in
+class ReadOnlyHandler : public vla::PduHandlerBase<ReadOnlyHandler> {
+  public:
+    static constexpr vla::FunctionSet SUPPORTED_FUNCTIONS =
+        RtuFunctionCode::READ_HOLDING_REGISTERS |
+        RtuFunctionCode::WRITE_SINGLE_REGISTER;
+
+    uint16_t registers[4] = {};
+
+    bool is_read_registers_supported() {
+        return true;
+    }
+    bool is_write_registers_supported() {
+        return true;
+    }
+    bool execute_read_single_register(uint16_t address, uint16_t *w) {
+        *w = registers[address];
+        return true;
+    }
+    bool execute_write_single_register(uint16_t address, uint16_t v) {
+        registers[address] = v;
+        return true;
+    }
+    ReadOnlyHandler()
+        : vla::PduHandlerBase<ReadOnlyHandler>(vla::RtuAddress(1)) {
+    }
+};
+
+static Handler handler;
+static ReadOnlyHandler read_only;
+
+static void test_mask_write_register() {
+    // (0x0012 & 0x00f2) | (0x0025 & ~0x00f2)
+    handler.registers[4] = 0x0012;
+    check_reply(handler, {1, 0x16, 0x00, 0x04, 0x00, 0xf2, 0x00, 0x25},
+                {1, 0x16, 0x00, 0x04, 0x00, 0xf2, 0x00, 0x25});
+    CHECK(handler.registers[4] == 0x0017);
+    check_exception(handler, {1, 0x16, 0x00, 0x14, 0xff, 0xff, 0x00, 0x00},
+                    RtuExceptionCode::ILLEGAL_DATA_ADDRESS);
+}
+
+static void test_read_write_registers() {
+    const uint16_t values[] = {0x00fe, 0x0acd, 0x0001,
+                               0x0003, 0x000d, 0x00ff};
+    for (int i = 0; i < 6; ++i) {
+        handler.registers[3 + i] = values[i];
+    }
+    check_reply(handler,
+                {1, 0x17, 0x00, 0x03, 0x00, 0x06, 0x00, 0x0e, 0x00, 0x03,
+                 0x06, 0x00, 0xff, 0x00, 0xff, 0x00, 0xff},
+                {1, 0x17, 0x0c, 0x00, 0xfe, 0x0a, 0xcd, 0x00, 0x01, 0x00,
+                 0x03, 0x00, 0x0d, 0x00, 0xff});
+    CHECK(handler.registers[14] == 0x00ff);
+    CHECK(handler.registers[16] == 0x00ff);
+    // the write goes first, the read sees it
+    check_reply(handler,
+                {1, 0x17, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+                 0x02, 0x12, 0x34},
+                {1, 0x17, 0x02, 0x12, 0x34});
+    // the byte count does not match the write count
+    check_exception(handler,
+                    {1, 0x17, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+                     0x01, 0x04, 0x12, 0x34},
+                    RtuExceptionCode::ILLEGAL_DATA_VALUE);
+    check_exception(handler,
+                    {1, 0x17, 0x00, 0x00, 0x00, 0x01, 0x00, 0x13, 0x00,
+                     0x02, 0x04, 0x00, 0x00, 0x00, 0x00},
+                    RtuExceptionCode::ILLEGAL_DATA_ADDRESS);
+}
+
+static void test_addressing() {
+    check_reply(handler, {2, 0x03, 0x00, 0x00, 0x00, 0x01}, {});
+    // broadcasts are handled, the daemon does not send the reply
+    check_reply(handler, {0, 0x06, 0x00, 0x01, 0xab, 0xcd},
+                {0, 0x06, 0x00, 0x01, 0xab, 0xcd});
+    CHECK(handler.registers[1] == 0xabcd);
+}
+
+// the coils are not supported, 0x41 is no function at all
+static void test_unsupported_functions() {
+    check_exception(handler, {1, 0x01, 0x00, 0x00, 0x00, 0x01},
+                    RtuExceptionCode::ILLEGAL_FUNCTION);
+    check_exception(handler, {1, 0x41, 0x00, 0x00},
+                    RtuExceptionCode::ILLEGAL_FUNCTION);
+}
+
+static void test_supported_functions() {
+    check_reply(read_only, {1, 0x06, 0x00, 0x02, 0x00, 0x07},
+                {1, 0x06, 0x00, 0x02, 0x00, 0x07});
+    check_reply(read_only, {1, 0x03, 0x00, 0x02, 0x00, 0x01},
+                {1, 0x03, 0x02, 0x00, 0x07});
+    // the hooks are there, the code to serve them is not
+    check_exception(read_only,
+                    {1, 0x10, 0x00, 0x00, 0x00, 0x01, 0x02, 0x00, 0x01},
+                    RtuExceptionCode::ILLEGAL_FUNCTION);
+    check_exception(read_only, {1, 0x16, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00},
+                    RtuExceptionCode::ILLEGAL_FUNCTION);
+    CHECK(read_only.registers[0] == 0);
+    CHECK(read_only.registers[2] == 0x0007);
+}
+
+int main() {
+    test_mask_write_register();
+    test_read_write_registers();
+    test_addressing();
+    test_unsupported_functions();
+    test_supported_functions();
+    return vla::test::result();
+}
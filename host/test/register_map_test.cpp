@@ -0,0 +1,142 @@
+#include <atomic>
+#include <cstdint>
+
+#include <vla/pdu_handler_base.hpp>
+#include <vla/register_map.hpp>
+
+#include "modbus_test.hpp"
+
+// Holding registers served from a RegisterMap: an array, read only
+// atomics right after it, a gap and a pair of callback registers.
+
+using vla::RtuExceptionCode;
+using vla::test::check_exception;
+using vla::test::check_reply;
+
+static uint16_t setpoints[4];
+static std::atomic<uint16_t> status[2];
+static uint16_t written_by_callback;
+
+static bool read_computed(uint16_t address, uint16_t *value) {
+    *value = address == 0x20 ? 0xbeef : written_by_callback;
+    return true;
+}
+
+static bool write_computed(uint16_t address, uint16_t value) {
+    if (address != 0x21) {
+        return false;
+    }
+    written_by_callback = value;
+    return true;
+}
+
+static constexpr vla::RegisterRange ranges[] = {
+    vla::array_registers(0, setpoints),
+    vla::atomic_registers(4, status, false),
+    vla::callback_registers(0x20, 2, read_computed, write_computed),
+};
+using Registers = vla::RegisterMap<ranges>;
+
+class Handler : public vla::PduHandlerBase<Handler> {
+  public:
+    bool is_read_registers_supported() {
+        return true;
+    }
+    bool is_write_registers_supported() {
+        return true;
+    }
+    bool is_read_registers_valid_data_address(uint16_t address,
+                                              uint16_t register_count) {
+        return Registers::is_readable(address, register_count);
+    }
+    bool is_write_registers_valid_data_address(uint16_t address,
+                                               uint16_t register_count) {
+        return Registers::is_writable(address, register_count);
+    }
+    bool execute_read_registers(uint16_t address, uint16_t register_count,
+                                vla::RegisterWords words) {
+        return Registers::read(address, register_count, words);
+    }
+    bool execute_write_registers(uint16_t address,
+                                 vla::ConstRegisterWords words,
+                                 uint8_t register_count) {
+        return Registers::write(address, register_count, words);
+    }
+    Handler() : vla::PduHandlerBase<Handler>(vla::RtuAddress(1)) {
+    }
+};
+
+static Handler handler;
+
+static void test_read_across_ranges() {
+    setpoints[2] = 0x1234;
+    setpoints[3] = 0x5678;
+    status[0]    = 0x0001;
+    status[1]    = 0xa5a5;
+    check_reply(handler, {1, 0x03, 0x00, 0x02, 0x00, 0x04},
+                {1, 0x03, 0x08, 0x12, 0x34, 0x56, 0x78, 0x00, 0x01, 0xa5,
+                 0xa5});
+    check_reply(handler, {1, 0x03, 0x00, 0x20, 0x00, 0x01},
+                {1, 0x03, 0x02, 0xbe, 0xef});
+}
+
+static void test_write_array() {
+    check_reply(handler,
+                {1, 0x10, 0x00, 0x00, 0x00, 0x02, 0x04, 0x00, 0x0a, 0x01,
+                 0x02},
+                {1, 0x10, 0x00, 0x00, 0x00, 0x02});
+    CHECK(setpoints[0] == 0x000a);
+    CHECK(setpoints[1] == 0x0102);
+    check_reply(handler, {1, 0x06, 0x00, 0x03, 0xff, 0xfe},
+                {1, 0x06, 0x00, 0x03, 0xff, 0xfe});
+    CHECK(setpoints[3] == 0xfffe);
+}
+
+static void test_write_callback() {
+    check_reply(handler, {1, 0x06, 0x00, 0x21, 0x43, 0x21},
+                {1, 0x06, 0x00, 0x21, 0x43, 0x21});
+    CHECK(written_by_callback == 0x4321);
+    check_reply(handler, {1, 0x03, 0x00, 0x21, 0x00, 0x01},
+                {1, 0x03, 0x02, 0x43, 0x21});
+    // the range is writable, the callback refuses the register
+    check_exception(handler, {1, 0x06, 0x00, 0x20, 0x00, 0x00},
+                    RtuExceptionCode::SERVER_DEVICE_FAILURE);
+}
+
+// only the bulk hooks, 0x16 goes through them
+static void test_mask_write() {
+    setpoints[1] = 0x0012;
+    check_reply(handler, {1, 0x16, 0x00, 0x01, 0x00, 0xf2, 0x00, 0x25},
+                {1, 0x16, 0x00, 0x01, 0x00, 0xf2, 0x00, 0x25});
+    CHECK(setpoints[1] == 0x0017);
+    check_reply(handler, {1, 0x16, 0x00, 0x21, 0xff, 0x00, 0x00, 0x0f},
+                {1, 0x16, 0x00, 0x21, 0xff, 0x00, 0x00, 0x0f});
+    CHECK(written_by_callback == 0x430f);
+    check_exception(handler, {1, 0x16, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00},
+                    RtuExceptionCode::ILLEGAL_DATA_ADDRESS);
+}
+
+static void test_bad_addresses() {
+    // the gap between the atomics and the callbacks
+    check_exception(handler, {1, 0x03, 0x00, 0x05, 0x00, 0x02},
+                    RtuExceptionCode::ILLEGAL_DATA_ADDRESS);
+    check_exception(handler, {1, 0x03, 0x00, 0x21, 0x00, 0x02},
+                    RtuExceptionCode::ILLEGAL_DATA_ADDRESS);
+    // read only atomics at the end of the block
+    check_exception(handler,
+                    {1, 0x10, 0x00, 0x03, 0x00, 0x02, 0x04, 0x00, 0x00,
+                     0x00, 0x00},
+                    RtuExceptionCode::ILLEGAL_DATA_ADDRESS);
+    CHECK(setpoints[3] == 0xfffe);
+    check_exception(handler, {1, 0x03, 0x00, 0x00, 0x00, 0x00},
+                    RtuExceptionCode::ILLEGAL_DATA_VALUE);
+}
+
+int main() {
+    test_read_across_ranges();
+    test_write_array();
+    test_write_callback();
+    test_mask_write();
+    test_bad_addresses();
+    return vla::test::result();
+}
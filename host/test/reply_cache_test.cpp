@@ -0,0 +1,107 @@
+#include <cstdint>
+#include <unistd.h>
+
+#include <vla/modbus_stats.hpp>
+#include <vla/pdu_handler_base.hpp>
+#include <vla/reply_cache.hpp>
+
+#include "modbus_test.hpp"
+
+// A ReplyCache in front of a handler that counts the requests that
+// reach it.
+
+using vla::test::check_reply;
+
+class Handler : public vla::PduHandlerBase<Handler> {
+  public:
+    uint16_t registers[4] = {};
+    int writes            = 0;
+
+    bool is_read_registers_supported() {
+        return true;
+    }
+    bool is_write_registers_supported() {
+        return true;
+    }
+    bool is_read_registers_valid_data_address(uint16_t address,
+                                              uint16_t register_count) {
+        return address + register_count <= 4;
+    }
+    bool is_write_registers_valid_data_address(uint16_t address,
+                                               uint16_t register_count) {
+        return address + register_count <= 4;
+    }
+    bool execute_read_single_register(uint16_t address, uint16_t *w) {
+        *w = registers[address];
+        return true;
+    }
+    bool execute_write_single_register(uint16_t address, uint16_t v) {
+        registers[address] = v;
+        ++writes;
+        return true;
+    }
+    Handler() : vla::PduHandlerBase<Handler>(vla::RtuAddress(1)) {
+    }
+};
+
+static constexpr auto window = vla::PeriodUs(20000);
+
+static Handler handler;
+static vla::ModbusStats stats;
+static auto cache = vla::ReplyCache(handler, window);
+
+static void test_retry() {
+    const vla::test::Bytes write = {1, 0x06, 0x00, 0x00, 0x12, 0x34};
+    check_reply(cache, write, write);
+    check_reply(cache, write, write);
+    CHECK(handler.writes == 1);
+    CHECK(stats.reply_cache_hits == 1);
+    // only the last exchange is kept
+    check_reply(cache, {1, 0x03, 0x00, 0x00, 0x00, 0x01},
+                {1, 0x03, 0x02, 0x12, 0x34});
+    check_reply(cache, write, write);
+    CHECK(handler.writes == 2);
+    CHECK(stats.reply_cache_hits == 1);
+}
+
+static void test_window() {
+    const vla::test::Bytes write = {1, 0x06, 0x00, 0x01, 0x00, 0x01};
+    auto writes = handler.writes;
+    check_reply(cache, write, write);
+    usleep(2 * window.us);
+    check_reply(cache, write, write);
+    CHECK(handler.writes == writes + 2);
+}
+
+static void test_broadcast() {
+    const vla::test::Bytes write = {0, 0x06, 0x00, 0x02, 0x00, 0x05};
+    auto writes = handler.writes;
+    // the daemon drops the reply the handler builds for them
+    vla::test::request(cache, write);
+    vla::test::request(cache, write);
+    CHECK(handler.writes == writes + 2);
+    CHECK(handler.registers[2] == 5);
+}
+
+// exceptions and counters are never answered from the cache
+static void test_not_kept() {
+    auto hits = stats.reply_cache_hits;
+    vla::test::check_exception(cache, {1, 0x06, 0x00, 0x04, 0x00, 0x01},
+                               vla::RtuExceptionCode::ILLEGAL_DATA_ADDRESS);
+    vla::test::check_exception(cache, {1, 0x06, 0x00, 0x04, 0x00, 0x01},
+                               vla::RtuExceptionCode::ILLEGAL_DATA_ADDRESS);
+    stats.comm_events = 5;
+    check_reply(cache, {1, 0x0b}, {1, 0x0b, 0x00, 0x00, 0x00, 0x05});
+    stats.comm_events = 6;
+    check_reply(cache, {1, 0x0b}, {1, 0x0b, 0x00, 0x00, 0x00, 0x06});
+    CHECK(stats.reply_cache_hits == hits);
+}
+
+int main() {
+    cache.attach_stats(&stats);
+    test_retry();
+    test_window();
+    test_broadcast();
+    test_not_kept();
+    return vla::test::result();
+}
@@ -0,0 +1,94 @@
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include <vla/pdu_handler_base.hpp>
+#include <vla/seqlock_bank.hpp>
+
+#include "modbus_test.hpp"
+
+// Input registers served from a SeqlockBank, and a producer thread
+// updating every register while the handler reads them.
+
+using vla::RtuExceptionCode;
+using vla::test::Bytes;
+using vla::test::check_exception;
+using vla::test::check_reply;
+
+class Handler : public vla::PduHandlerBase<Handler> {
+  public:
+    vla::SeqlockBank<100> bank;
+
+    bool is_read_input_registers_supported() {
+        return true;
+    }
+    bool is_read_input_registers_valid_data_address(uint16_t address,
+                                                    uint16_t register_count) {
+        return bank.is_valid_data_address(address, register_count);
+    }
+    bool execute_read_input_registers(uint16_t address,
+                                      uint16_t register_count,
+                                      vla::RegisterWords words) {
+        bank.read(address, register_count, words);
+        return true;
+    }
+    Handler() : vla::PduHandlerBase<Handler>(vla::RtuAddress(1)) {
+    }
+};
+
+static Handler handler;
+
+static void test_read() {
+    handler.bank.write_u32(0, 0x12345678);
+    handler.bank.write(99, 0xabcd);
+    check_reply(handler, {1, 0x04, 0x00, 0x00, 0x00, 0x02},
+                {1, 0x04, 0x04, 0x12, 0x34, 0x56, 0x78});
+    check_reply(handler, {1, 0x04, 0x00, 0x63, 0x00, 0x01},
+                {1, 0x04, 0x02, 0xab, 0xcd});
+    CHECK(handler.bank.read(1) == 0x5678);
+    check_exception(handler, {1, 0x04, 0x00, 0x63, 0x00, 0x02},
+                    RtuExceptionCode::ILLEGAL_DATA_ADDRESS);
+    // no write hooks, the bank is only written by its producer
+    check_exception(handler, {1, 0x06, 0x00, 0x00, 0x00, 0x00},
+                    RtuExceptionCode::ILLEGAL_FUNCTION);
+}
+
+// every register holds the same counter. A torn read shows up as a
+// reply with two values in it.
+static void test_concurrent_producer() {
+    uint16_t words[100] = {};
+    handler.bank.write(0, words, 100);
+    std::atomic<bool> done{false};
+    std::thread producer([&] {
+        for (uint16_t n = 1; !done.load(std::memory_order_relaxed); ++n) {
+            for (auto &w : words) {
+                w = n;
+            }
+            handler.bank.write(0, words, 100);
+        }
+    });
+    int torn = 0;
+    for (int i = 0; i < 20000; ++i) {
+        Bytes reply =
+            vla::test::request(handler, {1, 0x04, 0x00, 0x00, 0x00, 100});
+        if (reply.size() != 203) {
+            ++torn;
+            continue;
+        }
+        for (int b = 5; b < 203; b += 2) {
+            if (reply[b] != reply[3] || reply[b + 1] != reply[4]) {
+                ++torn;
+                break;
+            }
+        }
+    }
+    done = true;
+    producer.join();
+    CHECK(torn == 0);
+}
+
+int main() {
+    test_read();
+    test_concurrent_producer();
+    return vla::test::result();
+}
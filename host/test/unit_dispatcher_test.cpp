@@ -0,0 +1,79 @@
+#include <cstdint>
+
+#include <vla/pdu_handler_base.hpp>
+#include <vla/unit_dispatcher.hpp>
+
+#include "modbus_test.hpp"
+
+// Two units, each with its own holding registers, behind a
+// UnitDispatcher.
+
+using vla::test::check_reply;
+
+class Handler : public vla::PduHandlerBase<Handler> {
+  public:
+    uint16_t registers[2] = {};
+
+    bool is_read_registers_supported() {
+        return true;
+    }
+    bool is_write_registers_supported() {
+        return true;
+    }
+    bool is_read_registers_valid_data_address(uint16_t address,
+                                              uint16_t register_count) {
+        return address + register_count <= 2;
+    }
+    bool is_write_registers_valid_data_address(uint16_t address,
+                                               uint16_t register_count) {
+        return address + register_count <= 2;
+    }
+    bool execute_read_single_register(uint16_t address, uint16_t *w) {
+        *w = registers[address];
+        return true;
+    }
+    bool execute_write_single_register(uint16_t address, uint16_t v) {
+        registers[address] = v;
+        return true;
+    }
+    Handler(vla::RtuAddress addr) : vla::PduHandlerBase<Handler>(addr) {
+    }
+};
+
+static auto unit1 = Handler(vla::RtuAddress(1));
+static auto unit2 = Handler(vla::RtuAddress(2));
+static auto units =
+    vla::UnitDispatcher<vla::Unit<1, unit1>, vla::Unit<2, unit2>>();
+
+static void test_unicast() {
+    check_reply(units, {1, 0x06, 0x00, 0x00, 0x00, 0x11},
+                {1, 0x06, 0x00, 0x00, 0x00, 0x11});
+    check_reply(units, {2, 0x06, 0x00, 0x00, 0x00, 0x22},
+                {2, 0x06, 0x00, 0x00, 0x00, 0x22});
+    check_reply(units, {1, 0x03, 0x00, 0x00, 0x00, 0x01},
+                {1, 0x03, 0x02, 0x00, 0x11});
+    check_reply(units, {2, 0x03, 0x00, 0x00, 0x00, 0x01},
+                {2, 0x03, 0x02, 0x00, 0x22});
+    // no such unit
+    CHECK(vla::test::request(units, {3, 0x03, 0x00, 0x00, 0x00, 0x01})
+              .empty());
+    CHECK(units.serves(vla::RtuAddress(1)));
+    CHECK(units.serves(vla::RtuAddress(2)));
+    CHECK(!units.serves(vla::RtuAddress(3)));
+}
+
+// every unit handles a broadcast, none answers it
+static void test_broadcast() {
+    CHECK(vla::test::request(units, {0, 0x06, 0x00, 0x01, 0x00, 0x33})
+              .empty());
+    CHECK(unit1.registers[1] == 0x33);
+    CHECK(unit2.registers[1] == 0x33);
+    CHECK(unit1.registers[0] == 0x11);
+    CHECK(unit2.registers[0] == 0x22);
+}
+
+int main() {
+    test_unicast();
+    test_broadcast();
+    return vla::test::result();
+}
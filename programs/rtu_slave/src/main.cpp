@@ -6,9 +6,14 @@
 #include <variant>
 
 #include <vla/adc.hpp>
+#include <vla/adc_capture.hpp>
+#include <vla/adc_input_registers.hpp>
+#include <vla/device_identification.hpp>
+#include <vla/file_record_store.hpp>
 #include <vla/modbus_daemon.hpp>
 #include <vla/pdu_handler_base.hpp>
 #include <vla/queue.hpp>
+#include <vla/reply_cache.hpp>
 #include <vla/serial_io.hpp>
 #include <vla/task.hpp>
 
@@ -53,41 +58,131 @@ static void switch_led(SwitchLedConfig c) {
     }
 }
 
+template <vla::adc::AdcInput Channel>
+static bool read_capture(uint16_t record, uint16_t record_count,
+                         vla::RegisterWords words) {
+    return vla::adc::capture_read(Channel, record, record_count, words);
+}
+
+// the last capture of each ADC channel is the file of its number plus 1
+using vla::adc::AdcInput;
+static constexpr vla::RecordFile capture_files[] = {
+    vla::callback_file(1, vla::adc::CAPTURE_DEPTH,
+                       read_capture<AdcInput::ADC_0>),
+    vla::callback_file(2, vla::adc::CAPTURE_DEPTH,
+                       read_capture<AdcInput::ADC_1>),
+    vla::callback_file(5, vla::adc::CAPTURE_DEPTH,
+                       read_capture<AdcInput::ADC_4>),
+};
+using CaptureFiles = vla::FileRecordStore<capture_files>;
+
+static constexpr vla::DeviceObject identification_objects[] = {
+    {vla::DeviceObjectId::VENDOR_NAME, "VLA"},
+    {vla::DeviceObjectId::PRODUCT_CODE, "pico-freertos rtu_slave"},
+    {vla::DeviceObjectId::MAJOR_MINOR_REVISION, "1.0"},
+    {vla::DeviceObjectId::PRODUCT_NAME, "RP2040 ADC Modbus RTU slave"},
+};
+using Identification = vla::DeviceIdentification<identification_objects>;
+
+// the ADC channels are input registers 0 to 4, holding register 0 keeps
+// a value written by the master. Writing holding register 1 arms a
+// capture on a rising edge of ADC 0 over the value written, reading it
+// gives the CaptureState. Holding register 2 is read only, it gives the
+// stack high water mark of the Modbus task in words.
 class RtuHandler : public vla::PduHandlerBase<RtuHandler> {
+    vla::AdcInputRegisters adc_registers;
     uint16_t stored_value;
   public:
+    static constexpr vla::FunctionSet SUPPORTED_FUNCTIONS =
+        vla::RtuFunctionCode::READ_INPUT_REGISTER |
+        vla::RtuFunctionCode::READ_HOLDING_REGISTERS |
+        vla::RtuFunctionCode::WRITE_SINGLE_REGISTER |
+        vla::RtuFunctionCode::WRITE_MULTIPLE_REGISTERS |
+        vla::RtuFunctionCode::DIAGNOSTIC |
+        vla::RtuFunctionCode::READ_FILE_RECORD |
+        vla::RtuFunctionCode::READ_DEVICE_IDENTIFICATION;
+
+    bool is_read_input_registers_supported() {
+        return true;
+    }
+    bool is_read_input_registers_valid_data_address(uint16_t address,
+                                                    uint16_t register_count) {
+        return adc_registers.is_valid_data_address(address, register_count);
+    }
+    bool execute_read_input_registers(uint16_t address,
+                                      uint16_t register_count,
+                                      vla::RegisterWords words) {
+        return adc_registers.read(address, register_count, words);
+    }
     bool is_read_registers_supported() {
         return true;
     }
     bool is_write_registers_supported() {
         return true;
     }
+    bool is_read_registers_valid_data_address(uint16_t address,
+                                              uint16_t register_count) {
+        return address + register_count <= 3;
+    }
+    bool is_write_registers_valid_data_address(uint16_t address,
+                                               uint16_t register_count) {
+        return address + register_count <= 2;
+    }
     bool execute_read_single_register(const uint16_t address, uint16_t *w) {
-        if (address <= uint16_t(vla::adc::AdcInput::ADC_4)) {
-            auto adci = vla::adc::AdcInput(address);
-            *w        = vla::adc::read(adci).value_or(-1);
-        } else if (address == uint16_t(vla::adc::AdcInput::ADC_4) + 1) {
+        switch (address) {
+        case 0:
             *w = stored_value;
-        } else {
-            *w = uint16_t(-1);
+            break;
+        case 1:
+            *w = uint16_t(vla::adc::capture_state());
+            break;
+        default:
+            // handlers run in the Modbus task
+            *w = uxTaskGetStackHighWaterMark(nullptr);
+            break;
         }
-
         return true;
     }
     bool execute_write_single_register(const uint16_t address, uint16_t v) {
-        if (address == uint16_t(vla::adc::AdcInput::ADC_4) + 1) {
+        if (address == 0) {
             stored_value = v;
+            return true;
         }
+        auto config      = vla::adc::CaptureConfig();
+        config.threshold = v;
+        return vla::adc::capture_arm(config);
+    }
+    bool is_read_file_record_supported() {
         return true;
     }
+    bool is_read_file_record_valid_data_address(uint16_t file,
+                                                uint16_t record,
+                                                uint16_t record_count) {
+        return CaptureFiles::is_readable(file, record, record_count);
+    }
+    bool execute_read_file_record(uint16_t file, uint16_t record,
+                                  uint16_t record_count,
+                                  vla::RegisterWords words) {
+        return CaptureFiles::read(file, record, record_count, words);
+    }
+    const vla::DeviceIdentificationTable *device_identification() {
+        return &Identification::table;
+    }
     RtuHandler(vla::RtuAddress addr) : vla::PduHandlerBase<RtuHandler>(addr) {
     }
 };
 
 static auto rtu_handler = RtuHandler(vla::RtuAddress(0x01));
-void handle_modbus_message(const vla::RtuMessage &indication,
-                           vla::RtuMessage &reply) {
-    rtu_handler.handle_indication(indication, reply);
+// a master resending a write whose reply got lost must not arm a
+// second capture.
+static auto cached_handler =
+    vla::ReplyCache(rtu_handler, vla::PeriodUs(50000));
+
+static void modbus_manager(OutputQueue::Sender outq) {
+    // static but created here, once the scheduler runs
+    static vla::ModbusDaemonContext context;
+    vla::modbus_daemon_stdin(context, outq, cached_handler,
+                             vla::RxMode::FRAMES);
 }
 
 int main() {
@@ -125,9 +220,8 @@ int main() {
     configASSERT(outputTask);
 
     // publish the most recent ADC value via modbus.
-    auto modbus_task = vla::Task(
-        std::bind(vla::modbus_daemon_stdin, oq.sender(), handle_modbus_message),
-        "Modbus Task", 1024);
+    auto modbus_task = vla::Task(std::bind(modbus_manager, oq.sender()),
+                                 "Modbus Task", 512);
 
     vTaskStartScheduler();
     while (1) {
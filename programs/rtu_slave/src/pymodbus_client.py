@@ -22,15 +22,22 @@ def main():
         timeout=0.01)
     conn = client.connect()
 
-    print('client.read_holding_registers(0x0000, 1, unit=0x01)')
-    registers = client.read_holding_registers(0x0000, 8, unit=0x01)
+    # the ADC channels
+    print('client.read_input_registers(0x0000, 5, unit=0x01)')
+    registers = client.read_input_registers(0x0000, 5, unit=0x01)
     print(registers.registers)
 
-    print('client.write_register(0x0005, 0xff, unit=0x01)')
-    registers = client.write_register(0x0005, 0xff, unit=0x01)
+    # the stored value, the capture state and the Modbus task stack
+    # high water mark
+    print('client.read_holding_registers(0x0000, 3, unit=0x01)')
+    registers = client.read_holding_registers(0x0000, 3, unit=0x01)
+    print(registers.registers)
+
+    print('client.write_register(0x0000, 0xff, unit=0x01)')
+    registers = client.write_register(0x0000, 0xff, unit=0x01)
 
-    print('client.read_holding_registers(0x0000, 1, unit=0x01)')
-    registers = client.read_holding_registers(0x0000, 8, unit=0x01)
+    print('client.read_holding_registers(0x0000, 2, unit=0x01)')
+    registers = client.read_holding_registers(0x0000, 2, unit=0x01)
     print(registers.registers)
 
 if __name__ == '__main__':